@@ -0,0 +1,368 @@
+/*
+ * NVIDIA Last-Known-Good Settings Applier
+ *
+ * A oneshot tool for early boot: restores the locked graphics clocks,
+ * memory clock offset and graphics clock offset that gpu_offset_control_v2
+ * saved as last-known-good, directly through NVML, in milliseconds.
+ * The controller starts later and, seeing the marker this tool leaves in
+ * /run, does not redo the same writes.
+ *
+ * Input  (one file per GPU, written by gpu_offset_control_v2):
+ *   /var/lib/gpu-offset-control/gpu<N>.lkg
+ *     gpu=0 offset=150 locked_min=210 locked_max=1740 memory_offset=0
+ * Output (per boot, read by gpu_offset_control_v2):
+ *   /run/gpu-offset-control/gpu<N>.boot   same line format, settings applied
+ *
+ * Compile: gcc -O2 -o nvidia_lkg_apply nvidia_lkg_apply.c -ldl
+ * Run:     sudo ./nvidia_lkg_apply [-s state_dir] [-r run_dir] [-n]
+ * Install: see nvidia-lkg-apply.service
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <dlfcn.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+/* NVML Constants */
+#define NVML_LIBRARY "libnvidia-ml.so.1"
+#define NVML_SUCCESS 0
+#define NVML_CLOCK_GRAPHICS 0
+#define NVML_CLOCK_MEM 2
+#define NVML_PSTATE_0 0
+
+#define DEFAULT_STATE_DIR "/var/lib/gpu-offset-control"
+#define DEFAULT_RUN_DIR "/run/gpu-offset-control"
+#define MAX_PATH_LENGTH 512
+#define MAX_LINE_LENGTH 256
+
+/* Type definitions */
+typedef int nvmlReturn_t;
+typedef void* nvmlDevice_t;
+
+/*
+ * nvmlClockOffset_v1_t
+ * Used with nvmlDeviceSetClockOffsets (driver 555+).
+ * version = sizeof(struct) | (1 << 24)
+ */
+typedef struct {
+    unsigned int version;
+    unsigned int type;           /* nvmlClockType_t */
+    unsigned int pstate;         /* nvmlPstates_t */
+    int clockOffsetMHz;
+    int minClockOffsetMHz;       /* output only */
+    int maxClockOffsetMHz;       /* output only */
+} nvmlClockOffset_t;
+
+#define NVML_CLOCK_OFFSET_V1 ((unsigned int)(sizeof(nvmlClockOffset_t) | (1 << 24)))
+
+/* Function pointer types for NVML functions */
+typedef nvmlReturn_t (*nvmlInit_t)(void);
+typedef nvmlReturn_t (*nvmlShutdown_t)(void);
+typedef nvmlReturn_t (*nvmlDeviceGetCount_t)(unsigned int *count);
+typedef nvmlReturn_t (*nvmlDeviceGetHandleByIndex_t)(unsigned int index, nvmlDevice_t *device);
+typedef nvmlReturn_t (*nvmlDeviceSetGpuLockedClocks_t)(nvmlDevice_t device, unsigned int min_mhz, unsigned int max_mhz);
+typedef nvmlReturn_t (*nvmlDeviceSetClockOffsets_t)(nvmlDevice_t device, nvmlClockOffset_t *info);
+typedef const char* (*nvmlErrorString_t)(nvmlReturn_t result);
+
+/*
+ * Settings of one GPU as stored in a .lkg file
+ * A field that is missing from the file is left untouched on the GPU.
+ */
+typedef struct {
+    int has_offset;
+    int offset;
+    int has_locked;
+    int locked_min;
+    int locked_max;
+    int has_memory_offset;
+    int memory_offset;
+} LkgSettings;
+
+/* Global variables */
+static void *nvml_lib = NULL;
+static struct {
+    nvmlInit_t init;
+    nvmlShutdown_t shutdown;
+    nvmlDeviceGetCount_t get_count;
+    nvmlDeviceGetHandleByIndex_t get_handle;
+    nvmlDeviceSetGpuLockedClocks_t set_locked_clocks;
+    nvmlDeviceSetClockOffsets_t set_clock_offsets;
+    nvmlErrorString_t error_string;
+} nvml;
+
+/*
+ * Load NVML and resolve the functions this tool uses
+ * nvmlDeviceSetClockOffsets is optional (older drivers): offsets are then skipped.
+ */
+int load_nvml(void) {
+    nvml_lib = dlopen(NVML_LIBRARY, RTLD_NOW);
+    if (!nvml_lib) {
+        fprintf(stderr, "Error: Could not load %s: %s\n", NVML_LIBRARY, dlerror());
+        return -1;
+    }
+
+    nvml.init = (nvmlInit_t)dlsym(nvml_lib, "nvmlInit_v2");
+    nvml.shutdown = (nvmlShutdown_t)dlsym(nvml_lib, "nvmlShutdown");
+    nvml.get_count = (nvmlDeviceGetCount_t)dlsym(nvml_lib, "nvmlDeviceGetCount_v2");
+    nvml.get_handle = (nvmlDeviceGetHandleByIndex_t)dlsym(nvml_lib, "nvmlDeviceGetHandleByIndex_v2");
+    nvml.set_locked_clocks = (nvmlDeviceSetGpuLockedClocks_t)dlsym(nvml_lib, "nvmlDeviceSetGpuLockedClocks");
+    nvml.set_clock_offsets = (nvmlDeviceSetClockOffsets_t)dlsym(nvml_lib, "nvmlDeviceSetClockOffsets");
+    nvml.error_string = (nvmlErrorString_t)dlsym(nvml_lib, "nvmlErrorString");
+
+    if (!nvml.init || !nvml.shutdown || !nvml.get_count || !nvml.get_handle ||
+        !nvml.set_locked_clocks || !nvml.error_string) {
+        fprintf(stderr, "Error: %s is missing required functions\n", NVML_LIBRARY);
+        dlclose(nvml_lib);
+        return -1;
+    }
+
+    if (!nvml.set_clock_offsets) {
+        fprintf(stderr, "Warning: nvmlDeviceSetClockOffsets not available, clock offsets will be skipped\n");
+    }
+
+    return 0;
+}
+
+/*
+ * Parse "key=value key=value ..." (first non-comment line) into settings
+ * Returns 0 on success, -1 if the file is missing or malformed.
+ */
+int read_lkg_file(const char *path, LkgSettings *settings) {
+    FILE *f = fopen(path, "r");
+    if (!f) return -1;
+
+    char line[MAX_LINE_LENGTH];
+    int found = 0;
+    while (fgets(line, sizeof(line), f)) {
+        if (line[0] == '#' || line[0] == '\n') continue;
+        found = 1;
+        break;
+    }
+    fclose(f);
+    if (!found) return -1;
+
+    memset(settings, 0, sizeof(*settings));
+    int has_min = 0, has_max = 0;
+    char *save = NULL;
+    for (char *field = strtok_r(line, " \t\n", &save); field; field = strtok_r(NULL, " \t\n", &save)) {
+        char *eq = strchr(field, '=');
+        if (!eq) return -1;
+        *eq = '\0';
+
+        char *end;
+        long value = strtol(eq + 1, &end, 10);
+        if (end == eq + 1 || *end != '\0') return -1;
+
+        if (strcmp(field, "offset") == 0) {
+            settings->offset = (int)value;
+            settings->has_offset = 1;
+        } else if (strcmp(field, "locked_min") == 0) {
+            settings->locked_min = (int)value;
+            has_min = 1;
+        } else if (strcmp(field, "locked_max") == 0) {
+            settings->locked_max = (int)value;
+            has_max = 1;
+        } else if (strcmp(field, "memory_offset") == 0) {
+            settings->memory_offset = (int)value;
+            settings->has_memory_offset = 1;
+        }
+        /* Unknown keys (e.g. gpu=) are ignored */
+    }
+    settings->has_locked = has_min && has_max && settings->locked_min > 0 &&
+                           settings->locked_min <= settings->locked_max;
+    return 0;
+}
+
+/*
+ * Set a P0 clock offset through NVML
+ */
+nvmlReturn_t set_clock_offset(nvmlDevice_t device, unsigned int clock_type, int offset_mhz) {
+    nvmlClockOffset_t info;
+    memset(&info, 0, sizeof(info));
+    info.version = NVML_CLOCK_OFFSET_V1;
+    info.type = clock_type;
+    info.pstate = NVML_PSTATE_0;
+    info.clockOffsetMHz = offset_mhz;
+    return nvml.set_clock_offsets(device, &info);
+}
+
+/*
+ * Apply settings to one GPU; clears the has_* flag of anything that failed
+ * Returns the number of failed writes.
+ */
+int apply_settings(unsigned int index, nvmlDevice_t device, LkgSettings *settings) {
+    int failures = 0;
+    nvmlReturn_t ret;
+
+    if (settings->has_locked) {
+        ret = nvml.set_locked_clocks(device, (unsigned int)settings->locked_min, (unsigned int)settings->locked_max);
+        if (ret == NVML_SUCCESS) {
+            printf("GPU %u: locked clocks %d-%d MHz\n", index, settings->locked_min, settings->locked_max);
+        } else {
+            fprintf(stderr, "GPU %u: SetGpuLockedClocks failed: %s\n", index, nvml.error_string(ret));
+            settings->has_locked = 0;
+            failures++;
+        }
+    }
+
+    if (!nvml.set_clock_offsets) {
+        settings->has_memory_offset = 0;
+        settings->has_offset = 0;
+        return failures;
+    }
+
+    if (settings->has_memory_offset) {
+        ret = set_clock_offset(device, NVML_CLOCK_MEM, settings->memory_offset);
+        if (ret == NVML_SUCCESS) {
+            printf("GPU %u: memory offset %d MHz\n", index, settings->memory_offset);
+        } else {
+            fprintf(stderr, "GPU %u: memory offset failed: %s\n", index, nvml.error_string(ret));
+            settings->has_memory_offset = 0;
+            failures++;
+        }
+    }
+
+    if (settings->has_offset) {
+        ret = set_clock_offset(device, NVML_CLOCK_GRAPHICS, settings->offset);
+        if (ret == NVML_SUCCESS) {
+            printf("GPU %u: graphics offset %d MHz\n", index, settings->offset);
+        } else {
+            fprintf(stderr, "GPU %u: graphics offset failed: %s\n", index, nvml.error_string(ret));
+            settings->has_offset = 0;
+            failures++;
+        }
+    }
+
+    return failures;
+}
+
+/*
+ * Record what was applied so the controller does not write it again
+ */
+void write_boot_marker(const char *run_dir, unsigned int index, const LkgSettings *settings) {
+    char path[MAX_PATH_LENGTH];
+    char tmp_path[MAX_PATH_LENGTH];
+
+    if (mkdir(run_dir, 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "Warning: Could not create %s: %s\n", run_dir, strerror(errno));
+        return;
+    }
+    snprintf(path, sizeof(path), "%s/gpu%u.boot", run_dir, index);
+    snprintf(tmp_path, sizeof(tmp_path), "%s/gpu%u.boot.tmp", run_dir, index);
+
+    FILE *f = fopen(tmp_path, "w");
+    if (!f) {
+        fprintf(stderr, "Warning: Could not write %s: %s\n", tmp_path, strerror(errno));
+        return;
+    }
+    fprintf(f, "# applied by nvidia_lkg_apply\n");
+    fprintf(f, "gpu=%u", index);
+    if (settings->has_offset) fprintf(f, " offset=%d", settings->offset);
+    if (settings->has_locked) fprintf(f, " locked_min=%d locked_max=%d", settings->locked_min, settings->locked_max);
+    if (settings->has_memory_offset) fprintf(f, " memory_offset=%d", settings->memory_offset);
+    fprintf(f, "\n");
+    fclose(f);
+
+    if (rename(tmp_path, path) != 0) {
+        fprintf(stderr, "Warning: Could not rename %s: %s\n", tmp_path, strerror(errno));
+    }
+}
+
+void print_usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-s state_dir] [-r run_dir] [-n]\n", prog);
+    fprintf(stderr, "  -s state_dir   Directory with gpu<N>.lkg files (default %s)\n", DEFAULT_STATE_DIR);
+    fprintf(stderr, "  -r run_dir     Directory for gpu<N>.boot markers (default %s)\n", DEFAULT_RUN_DIR);
+    fprintf(stderr, "  -n             Dry run: print what would be applied\n");
+}
+
+/*
+ * Main function - apply last-known-good settings to every GPU that has them
+ */
+int main(int argc, char **argv) {
+    const char *state_dir = DEFAULT_STATE_DIR;
+    const char *run_dir = DEFAULT_RUN_DIR;
+    int dry_run = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:r:nh")) != -1) {
+        switch (opt) {
+        case 's': state_dir = optarg; break;
+        case 'r': run_dir = optarg; break;
+        case 'n': dry_run = 1; break;
+        default:
+            print_usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    if (load_nvml() != 0) {
+        return 1;
+    }
+
+    nvmlReturn_t ret = nvml.init();
+    if (ret != NVML_SUCCESS) {
+        fprintf(stderr, "Error: nvmlInit failed: %s\n", nvml.error_string(ret));
+        dlclose(nvml_lib);
+        return 1;
+    }
+
+    unsigned int gpu_count = 0;
+    ret = nvml.get_count(&gpu_count);
+    if (ret != NVML_SUCCESS) {
+        fprintf(stderr, "Error: nvmlDeviceGetCount failed: %s\n", nvml.error_string(ret));
+        nvml.shutdown();
+        dlclose(nvml_lib);
+        return 1;
+    }
+
+    int failures = 0;
+    for (unsigned int i = 0; i < gpu_count; i++) {
+        char path[MAX_PATH_LENGTH];
+        LkgSettings settings;
+
+        snprintf(path, sizeof(path), "%s/gpu%u.lkg", state_dir, i);
+        if (read_lkg_file(path, &settings) != 0) {
+            printf("GPU %u: no last-known-good settings (%s)\n", i, path);
+            continue;
+        }
+
+        if (dry_run) {
+            printf("GPU %u: would apply offset=%d locked=%d-%d memory_offset=%d\n", i,
+                   settings.has_offset ? settings.offset : 0,
+                   settings.has_locked ? settings.locked_min : 0,
+                   settings.has_locked ? settings.locked_max : 0,
+                   settings.has_memory_offset ? settings.memory_offset : 0);
+            continue;
+        }
+
+        nvmlDevice_t device;
+        ret = nvml.get_handle(i, &device);
+        if (ret != NVML_SUCCESS) {
+            fprintf(stderr, "GPU %u: nvmlDeviceGetHandleByIndex failed: %s\n", i, nvml.error_string(ret));
+            failures++;
+            continue;
+        }
+
+        failures += apply_settings(i, device, &settings);
+        write_boot_marker(run_dir, i, &settings);
+    }
+
+    nvml.shutdown();
+    dlclose(nvml_lib);
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double elapsed_ms = (double)(end.tv_sec - start.tv_sec) * 1000.0 +
+                        (double)(end.tv_nsec - start.tv_nsec) / 1000000.0;
+    printf("Done in %.1f ms (%d failure(s))\n", elapsed_ms, failures);
+
+    return failures == 0 ? 0 : 1;
+}
@@ -10,20 +10,105 @@
  * Reference: https://github.com/weter11/LACT
  *
  * Compile: gcc -o nvidia_stats nvidia_stats.c -ldl
- * Run: ./nvidia_stats
+ * Run: ./nvidia_stats                 (one-shot report)
+ *      ./nvidia_stats -i 1000 [-n N]  (sample every 1000 ms, N ticks, 0 = forever)
+ *      ./nvidia_stats -i 100 -D hotspot=1,vram=1 -H 60
+ *                                     (deadband: emit a channel only when it moves)
+ *
+ * Memory: everything the sampling loop touches (sample structs, the sample
+ * ring, the stdout buffer) is carved out of a single arena allocated at
+ * startup. After the first tick the loop performs no heap allocations.
+ *
+ * Tracing: the sampling loop carries USDT probes (provider "nvidia_stats")
+ * that compile to a single nop each. List them with
+ *   readelf -n nvidia_stats | grep -A2 stapsdt
+ * and attach with e.g.
+ *   bpftrace -e 'usdt:./nvidia_stats:nvapi_return { @[arg1] = hist(arg2); }'
+ * Build with -DNVSTATS_NO_USDT to leave them out entirely.
  */
 
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
 #include <dlfcn.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+ * USDT probes
+ * Prefer <sys/sdt.h> when installed. Otherwise emit the same .note.stapsdt
+ * entries directly, so neither systemtap headers at build time nor any
+ * runtime library is needed. Every argument is passed as a signed 64-bit
+ * value ("-8@<operand>").
+ */
+#if !defined(NVSTATS_NO_USDT) && defined(__has_include)
+#  if __has_include(<sys/sdt.h>)
+#    include <sys/sdt.h>
+#    define NVSTATS_USDT_SYS_SDT 1
+#  endif
+#endif
+
+#if defined(NVSTATS_NO_USDT)
+#  define NVSTATS_PROBE1(name, a1) do { } while (0)
+#  define NVSTATS_PROBE2(name, a1, a2) do { } while (0)
+#  define NVSTATS_PROBE3(name, a1, a2, a3) do { } while (0)
+#elif defined(NVSTATS_USDT_SYS_SDT)
+#  define NVSTATS_PROBE1(name, a1) DTRACE_PROBE1(nvidia_stats, name, (int64_t)(a1))
+#  define NVSTATS_PROBE2(name, a1, a2) DTRACE_PROBE2(nvidia_stats, name, (int64_t)(a1), (int64_t)(a2))
+#  define NVSTATS_PROBE3(name, a1, a2, a3) \
+    DTRACE_PROBE3(nvidia_stats, name, (int64_t)(a1), (int64_t)(a2), (int64_t)(a3))
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__aarch64__))
+#  define NVSTATS_SDT_NOTE(name, args)                                          \
+    "990: nop\n"                                                                \
+    ".pushsection .note.stapsdt,\"?\",\"note\"\n"                                \
+    ".balign 4\n"                                                               \
+    ".4byte 992f-991f, 994f-993f, 3\n"                                          \
+    "991: .asciz \"stapsdt\"\n"                                                 \
+    "992: .balign 4\n"                                                          \
+    "993: .8byte 990b\n"                                                        \
+    ".8byte _.stapsdt.base\n"                                                   \
+    ".8byte 0\n"                                                                \
+    ".asciz \"nvidia_stats\"\n"                                                 \
+    ".asciz \"" #name "\"\n"                                                     \
+    ".asciz \"" args "\"\n"                                                      \
+    "994: .balign 4\n"                                                          \
+    ".popsection\n"                                                             \
+    ".ifndef _.stapsdt.base\n"                                                  \
+    ".pushsection .stapsdt.base,\"aG\",\"progbits\",.stapsdt.base,comdat\n"      \
+    ".weak _.stapsdt.base\n"                                                    \
+    ".hidden _.stapsdt.base\n"                                                  \
+    "_.stapsdt.base: .space 1\n"                                                \
+    ".size _.stapsdt.base, 1\n"                                                 \
+    ".popsection\n"                                                             \
+    ".endif\n"
+#  define NVSTATS_PROBE1(name, a1) \
+    __asm__ __volatile__ (NVSTATS_SDT_NOTE(name, "-8@%0") :: "nor"((int64_t)(a1)))
+#  define NVSTATS_PROBE2(name, a1, a2) \
+    __asm__ __volatile__ (NVSTATS_SDT_NOTE(name, "-8@%0 -8@%1") \
+                          :: "nor"((int64_t)(a1)), "nor"((int64_t)(a2)))
+#  define NVSTATS_PROBE3(name, a1, a2, a3) \
+    __asm__ __volatile__ (NVSTATS_SDT_NOTE(name, "-8@%0 -8@%1 -8@%2") \
+                          :: "nor"((int64_t)(a1)), "nor"((int64_t)(a2)), "nor"((int64_t)(a3)))
+#else
+#  define NVSTATS_PROBE1(name, a1) do { } while (0)
+#  define NVSTATS_PROBE2(name, a1, a2) do { } while (0)
+#  define NVSTATS_PROBE3(name, a1, a2, a3) do { } while (0)
+#endif
 
 /* NVAPI Constants */
 #define NVAPI_LIBRARY "libnvidia-api.so.1"
 #define NVAPI_MAX_PHYSICAL_GPUS 64
 #define NVAPI_SHORT_STRING_MAX 64
 
+/* Sampling pipeline sizing (all allocated once, at startup) */
+#define ARENA_SIZE          (256 * 1024)
+#define SAMPLE_RING_SLOTS   1024        /* must be a power of two */
+#define STDOUT_BUFFER_SIZE  (64 * 1024)
+
 /* NVAPI Query Interface IDs */
 #define QUERY_NVAPI_INITIALIZE       0x0150e828
 #define QUERY_NVAPI_UNLOAD           0xd22bdd7e
@@ -84,9 +169,139 @@ typedef struct {
 
 typedef NvAPI_Status (*NvAPI_GetVoltage_t)(NvPhysicalGpuHandle handle, NvApiVoltage *voltage);
 
+/*
+ * Arena
+ * A bump allocator backed by one allocation made at startup. Nothing is
+ * ever freed individually; the whole arena is released on exit. When the
+ * arena is exhausted arena_alloc() returns NULL instead of falling back
+ * to malloc, so a sizing mistake shows up at startup, not on the hot path.
+ */
+typedef struct {
+    uint8_t *base;
+    size_t size;
+    size_t used;
+} Arena;
+
+/*
+ * One sample of one GPU, as produced by a single tick
+ */
+typedef struct {
+    uint64_t timestamp_ns;   /* CLOCK_REALTIME */
+    uint32_t gpu;
+    uint32_t voltage_uv;     /* 0 if not available */
+    int32_t hotspot;         /* °C, -1 if not available */
+    int32_t vram;            /* °C, -1 if not available */
+    int32_t status;          /* 0 = ok, -1 = read error */
+} GpuSample;
+
+/*
+ * Deadband (change-data-capture) output
+ * A channel is printed only when it differs from its last printed value by
+ * more than its threshold, or when it has not been printed for heartbeat_ns.
+ * Every line carries its timestamp, so a reader can rebuild each channel
+ * as an exact step function: a value holds until the next line naming it.
+ */
+typedef enum {
+    CHANNEL_VOLTAGE_UV,
+    CHANNEL_HOTSPOT,
+    CHANNEL_VRAM,
+    CHANNEL_STATUS,
+    CHANNEL_COUNT
+} SampleChannel;
+
+static const char *channel_names[CHANNEL_COUNT] = { "voltage_uv", "hotspot", "vram", "status" };
+
+typedef struct {
+    int enabled;
+    int64_t threshold[CHANNEL_COUNT];  /* 0 = emit on any change */
+    uint64_t heartbeat_ns;
+} DeadbandConfig;
+
+typedef struct {
+    int primed;                        /* first sample emits every channel */
+    int64_t value[CHANNEL_COUNT];      /* last emitted value */
+    uint64_t emitted_ns[CHANNEL_COUNT];
+} DeadbandState;
+
+/*
+ * Single-producer ring of recent samples
+ * Slots are preallocated from the arena; publishing copies into a slot.
+ */
+typedef struct {
+    GpuSample *slots;
+    uint32_t mask;
+    uint64_t head;           /* total samples published */
+} SampleRing;
+
 /* Global variables */
 static void *nvapi_lib = NULL;
 static NvAPI_QueryInterface_t nvapi_QueryInterface = NULL;
+static volatile sig_atomic_t stop_requested = 0;
+
+/* Raw status of the most recent thermals/voltage call, for the nvapi_return probe */
+static NvAPI_Status nvapi_last_status = 0;
+
+/* NVAPI functions used on the sampling path, resolved once after init */
+static NvAPI_GetThermals_t nvapi_get_thermals = NULL;
+static NvAPI_GetVoltage_t nvapi_get_voltage = NULL;
+
+/*
+ * Initialize the arena with a single up-front allocation
+ */
+int arena_init(Arena *arena, size_t size) {
+    arena->base = malloc(size);
+    if (!arena->base) {
+        fprintf(stderr, "Error: Could not allocate %zu byte arena\n", size);
+        return -1;
+    }
+    memset(arena->base, 0, size); /* fault the pages in now, not on the first tick */
+    arena->size = size;
+    arena->used = 0;
+    return 0;
+}
+
+/*
+ * Carve a 16-byte aligned block out of the arena
+ */
+void* arena_alloc(Arena *arena, size_t size) {
+    size_t offset = (arena->used + 15) & ~(size_t)15;
+    if (offset > arena->size || size > arena->size - offset) {
+        fprintf(stderr, "Error: Arena exhausted (%zu of %zu bytes used, %zu requested)\n",
+                arena->used, arena->size, size);
+        return NULL;
+    }
+    arena->used = offset + size;
+    return arena->base + offset;
+}
+
+void arena_release(Arena *arena) {
+    free(arena->base);
+    arena->base = NULL;
+    arena->size = arena->used = 0;
+}
+
+/*
+ * Allocate the ring slots; slot_count must be a power of two
+ */
+int ring_init(SampleRing *ring, Arena *arena, uint32_t slot_count) {
+    ring->slots = arena_alloc(arena, sizeof(GpuSample) * slot_count);
+    if (!ring->slots) return -1;
+    ring->mask = slot_count - 1;
+    ring->head = 0;
+    return 0;
+}
+
+/*
+ * Publish a sample and return the slot it was stored in
+ */
+GpuSample* ring_publish(SampleRing *ring, const GpuSample *sample) {
+    GpuSample *slot = &ring->slots[ring->head & ring->mask];
+    *slot = *sample;
+    ring->head++;
+    /* probe: ring_publish(gpu, head, timestamp_ns) */
+    NVSTATS_PROBE3(ring_publish, slot->gpu, ring->head, slot->timestamp_ns);
+    return slot;
+}
 
 /*
  * Load NVAPI library and get the query interface function
@@ -133,10 +348,24 @@ int init_nvapi(void) {
         return -1;
     }
 
-    printf("NVAPI initialized successfully.\n\n");
     return 0;
 }
 
+/*
+ * Resolve the functions used on the sampling path
+ * Done once so each tick is a plain indirect call into the driver. Only the
+ * thermals call is required; without the voltage call the voltage is
+ * reported as not available.
+ */
+int resolve_nvapi_functions(void) {
+    nvapi_get_thermals = (NvAPI_GetThermals_t)get_nvapi_function(QUERY_NVAPI_THERMALS);
+    nvapi_get_voltage = (NvAPI_GetVoltage_t)nvapi_QueryInterface(QUERY_NVAPI_VOLTAGE);
+    if (!nvapi_get_voltage) {
+        fprintf(stderr, "Warning: Voltage query (ID 0x%08x) not available\n", QUERY_NVAPI_VOLTAGE);
+    }
+    return nvapi_get_thermals ? 0 : -1;
+}
+
 /*
  * Unload NVAPI
  */
@@ -174,7 +403,7 @@ int enum_physical_gpus(NvPhysicalGpuHandle *handles, uint32_t *count) {
  * This is necessary because different GPUs support different sensors
  */
 int32_t calculate_thermals_mask(NvPhysicalGpuHandle handle) {
-    NvAPI_GetThermals_t get_thermals = (NvAPI_GetThermals_t)get_nvapi_function(QUERY_NVAPI_THERMALS);
+    NvAPI_GetThermals_t get_thermals = nvapi_get_thermals;
     if (!get_thermals) return 1;
 
     NvApiThermals thermals;
@@ -212,7 +441,7 @@ int32_t calculate_thermals_mask(NvPhysicalGpuHandle handle) {
  * - VRAM temperature is at values[15] / 256
  */
 int get_thermals(NvPhysicalGpuHandle handle, int32_t mask, int32_t *hotspot, int32_t *vram) {
-    NvAPI_GetThermals_t get_thermals = (NvAPI_GetThermals_t)get_nvapi_function(QUERY_NVAPI_THERMALS);
+    NvAPI_GetThermals_t get_thermals = nvapi_get_thermals;
     if (!get_thermals) return -1;
 
     NvApiThermals thermals;
@@ -223,6 +452,7 @@ int get_thermals(NvPhysicalGpuHandle handle, int32_t mask, int32_t *hotspot, int
     thermals.mask = mask;
 
     NvAPI_Status status = get_thermals(handle, &thermals);
+    nvapi_last_status = status;
     if (status != 0) {
         fprintf(stderr, "Error: GetThermals failed with status 0x%08x\n", status);
         return -1;
@@ -251,7 +481,7 @@ int get_thermals(NvPhysicalGpuHandle handle, int32_t mask, int32_t *hotspot, int
  * Get voltage in microvolts
  */
 int get_voltage(NvPhysicalGpuHandle handle, uint32_t *voltage_uv) {
-    NvAPI_GetVoltage_t get_voltage = (NvAPI_GetVoltage_t)get_nvapi_function(QUERY_NVAPI_VOLTAGE);
+    NvAPI_GetVoltage_t get_voltage = nvapi_get_voltage;
     if (!get_voltage) return -1;
 
     NvApiVoltage voltage;
@@ -261,6 +491,7 @@ int get_voltage(NvPhysicalGpuHandle handle, uint32_t *voltage_uv) {
     voltage.version = sizeof(NvApiVoltage) | (1 << 16);
 
     NvAPI_Status status = get_voltage(handle, &voltage);
+    nvapi_last_status = status;
     if (status != 0) {
         fprintf(stderr, "Error: GetVoltage failed with status 0x%08x\n", status);
         return -1;
@@ -270,23 +501,312 @@ int get_voltage(NvPhysicalGpuHandle handle, uint32_t *voltage_uv) {
     return 0;
 }
 
+/*
+ * Signal handler - ask the sampling loop to stop after the current tick
+ */
+void handle_stop_signal(int sig) {
+    (void)sig;
+    stop_requested = 1;
+}
+
+uint64_t clock_ns(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/*
+ * Sleep until an absolute CLOCK_MONOTONIC deadline (drift-free ticks)
+ */
+void sleep_until_ns(uint64_t deadline_ns) {
+    struct timespec ts;
+    ts.tv_sec = (time_t)(deadline_ns / 1000000000ull);
+    ts.tv_nsec = (long)(deadline_ns % 1000000000ull);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {
+        if (stop_requested) return;
+    }
+}
+
+/*
+ * Read one GPU into a caller-provided sample (no allocation)
+ */
+void sample_gpu(NvPhysicalGpuHandle handle, uint32_t index, int32_t mask, GpuSample *sample) {
+    sample->timestamp_ns = clock_ns(CLOCK_REALTIME);
+    sample->gpu = index;
+    sample->status = 0;
+
+    /* probes: nvapi_entry(gpu, query_id), nvapi_return(gpu, query_id, nvapi_status) */
+    sample->voltage_uv = 0;
+    if (nvapi_get_voltage) {
+        NVSTATS_PROBE2(nvapi_entry, index, QUERY_NVAPI_VOLTAGE);
+        int rc = get_voltage(handle, &sample->voltage_uv);
+        NVSTATS_PROBE3(nvapi_return, index, QUERY_NVAPI_VOLTAGE, nvapi_last_status);
+        if (rc != 0) {
+            sample->voltage_uv = 0;
+            sample->status = -1;
+        }
+    }
+
+    NVSTATS_PROBE2(nvapi_entry, index, QUERY_NVAPI_THERMALS);
+    int rc = get_thermals(handle, mask, &sample->hotspot, &sample->vram);
+    NVSTATS_PROBE3(nvapi_return, index, QUERY_NVAPI_THERMALS, nvapi_last_status);
+    if (rc != 0) {
+        sample->hotspot = -1;
+        sample->vram = -1;
+        sample->status = -1;
+    }
+}
+
+/*
+ * Write one sample as a single line to the (arena-buffered) stdout
+ */
+void print_sample(const GpuSample *sample) {
+    printf("t=%llu.%03llu gpu=%u voltage_uv=%u hotspot=%d vram=%d status=%d\n",
+           (unsigned long long)(sample->timestamp_ns / 1000000000ull),
+           (unsigned long long)(sample->timestamp_ns % 1000000000ull / 1000000ull),
+           sample->gpu, sample->voltage_uv, sample->hotspot, sample->vram, sample->status);
+}
+
+int64_t sample_channel_value(const GpuSample *sample, SampleChannel channel) {
+    switch (channel) {
+    case CHANNEL_VOLTAGE_UV: return sample->voltage_uv;
+    case CHANNEL_HOTSPOT:    return sample->hotspot;
+    case CHANNEL_VRAM:       return sample->vram;
+    case CHANNEL_STATUS:     return sample->status;
+    default:                 return 0;
+    }
+}
+
+/*
+ * Write only the channels that left their deadband (or are due a heartbeat).
+ * Returns the number of channels written.
+ */
+int print_sample_deadband(const GpuSample *sample, DeadbandState *state, const DeadbandConfig *config) {
+    int64_t values[CHANNEL_COUNT];
+    unsigned emit_mask = 0;
+
+    for (int c = 0; c < CHANNEL_COUNT; c++) {
+        values[c] = sample_channel_value(sample, (SampleChannel)c);
+        int64_t delta = values[c] - state->value[c];
+        if (delta < 0) delta = -delta;
+
+        if (!state->primed || delta > config->threshold[c] ||
+            sample->timestamp_ns - state->emitted_ns[c] >= config->heartbeat_ns) {
+            emit_mask |= 1u << c;
+        }
+    }
+    state->primed = 1;
+
+    if (!emit_mask) return 0;
+
+    int emitted = 0;
+    printf("t=%llu.%03llu gpu=%u",
+           (unsigned long long)(sample->timestamp_ns / 1000000000ull),
+           (unsigned long long)(sample->timestamp_ns % 1000000000ull / 1000000ull),
+           sample->gpu);
+    for (int c = 0; c < CHANNEL_COUNT; c++) {
+        if (!(emit_mask & (1u << c))) continue;
+        printf(" %s=%lld", channel_names[c], (long long)values[c]);
+        state->value[c] = values[c];
+        state->emitted_ns[c] = sample->timestamp_ns;
+        emitted++;
+    }
+    putchar('\n');
+    return emitted;
+}
+
+/*
+ * Parse "channel=threshold[,channel=threshold...]" into the deadband config
+ */
+int parse_deadband(const char *spec, DeadbandConfig *config) {
+    const char *p = spec;
+    while (*p) {
+        const char *eq = strchr(p, '=');
+        if (!eq) return -1;
+
+        int channel = -1;
+        for (int c = 0; c < CHANNEL_COUNT; c++) {
+            size_t len = strlen(channel_names[c]);
+            if ((size_t)(eq - p) == len && strncmp(p, channel_names[c], len) == 0) {
+                channel = c;
+                break;
+            }
+        }
+        if (channel < 0) {
+            fprintf(stderr, "Error: Unknown deadband channel in '%s'\n", spec);
+            return -1;
+        }
+
+        char *end;
+        long long threshold = strtoll(eq + 1, &end, 10);
+        if (end == eq + 1 || threshold < 0 || (*end != ',' && *end != '\0')) return -1;
+        config->threshold[channel] = threshold;
+
+        p = (*end == ',') ? end + 1 : end;
+    }
+    config->enabled = 1;
+    return 0;
+}
+
+/*
+ * Periodic sampling loop
+ * All state lives in the arena or on the stack; the loop body itself does
+ * not allocate.
+ */
+int run_sampling_loop(NvPhysicalGpuHandle *handles, uint32_t gpu_count, Arena *arena,
+                      uint32_t interval_ms, uint64_t max_ticks, const DeadbandConfig *deadband) {
+    int32_t *masks = arena_alloc(arena, sizeof(int32_t) * gpu_count);
+    GpuSample *current = arena_alloc(arena, sizeof(GpuSample) * gpu_count);
+    DeadbandState *deadband_state = arena_alloc(arena, sizeof(DeadbandState) * gpu_count);
+    SampleRing ring;
+    if (!masks || !current || !deadband_state || ring_init(&ring, arena, SAMPLE_RING_SLOTS) != 0) {
+        return -1;
+    }
+
+    /* Probing the thermals mask costs up to 33 driver calls, so do it once */
+    for (uint32_t i = 0; i < gpu_count; i++) {
+        masks[i] = calculate_thermals_mask(handles[i]);
+    }
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = handle_stop_signal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    uint64_t interval_ns = (uint64_t)interval_ms * 1000000ull;
+    uint64_t deadline = clock_ns(CLOCK_MONOTONIC);
+
+    for (uint64_t tick = 0; !stop_requested && (max_ticks == 0 || tick < max_ticks); tick++) {
+        /* probes: tick_start(tick), tick_end(tick, gpu_count) */
+        NVSTATS_PROBE1(tick_start, tick);
+
+        for (uint32_t i = 0; i < gpu_count; i++) {
+            sample_gpu(handles[i], i, masks[i], &current[i]);
+            GpuSample *published = ring_publish(&ring, &current[i]);
+            if (deadband->enabled) {
+                print_sample_deadband(published, &deadband_state[i], deadband);
+            } else {
+                print_sample(published);
+            }
+        }
+        fflush(stdout);
+
+        NVSTATS_PROBE2(tick_end, tick, gpu_count);
+
+        deadline += interval_ns;
+        sleep_until_ns(deadline);
+    }
+
+    return 0;
+}
+
+/*
+ * Flush and close stdout, then release the arena that holds its buffer.
+ * Closing (rather than switching stdout to another buffer after it has
+ * been written to) keeps exit() from touching the freed buffer.
+ */
+int close_output(Arena *arena) {
+    int rc = fclose(stdout);
+    if (rc != 0) {
+        fprintf(stderr, "Error: Could not write output: %s\n", strerror(errno));
+    }
+    arena_release(arena);
+    return rc;
+}
+
+void print_usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-i interval_ms] [-n ticks] [-D channel=threshold,...] [-H seconds]\n", prog);
+    fprintf(stderr, "  (no options)     One-shot report of all GPUs\n");
+    fprintf(stderr, "  -i interval_ms   Sample all GPUs periodically, one line per GPU per tick\n");
+    fprintf(stderr, "  -n ticks         Stop after this many ticks (default 0 = until SIGINT/SIGTERM)\n");
+    fprintf(stderr, "  -D deadbands     Only print a channel when it moves by more than its threshold\n");
+    fprintf(stderr, "                   (channels: voltage_uv, hotspot, vram, status; unlisted = 0,\n");
+    fprintf(stderr, "                   i.e. any change), e.g. -D voltage_uv=5000,hotspot=1\n");
+    fprintf(stderr, "  -H seconds       Deadband heartbeat: reprint unchanged channels this often (default 60)\n");
+}
+
 /*
  * Main function - demonstrate reading NVIDIA GPU stats
  */
-int main(void) {
-    printf("=================================================\n");
-    printf("NVIDIA GPU Stats Reader\n");
-    printf("Using undocumented NVAPI calls from libnvidia-api.so.1\n");
-    printf("=================================================\n\n");
+int main(int argc, char **argv) {
+    uint32_t interval_ms = 0;
+    uint64_t max_ticks = 0;
+    DeadbandConfig deadband;
+    int opt;
+
+    memset(&deadband, 0, sizeof(deadband));
+    deadband.heartbeat_ns = 60ull * 1000000000ull;
+
+    while ((opt = getopt(argc, argv, "i:n:D:H:h")) != -1) {
+        switch (opt) {
+        case 'i':
+            interval_ms = (uint32_t)strtoul(optarg, NULL, 10);
+            if (interval_ms == 0) {
+                print_usage(argv[0]);
+                return 1;
+            }
+            break;
+        case 'n':
+            max_ticks = strtoull(optarg, NULL, 10);
+            break;
+        case 'D':
+            if (parse_deadband(optarg, &deadband) != 0) {
+                print_usage(argv[0]);
+                return 1;
+            }
+            break;
+        case 'H':
+            deadband.heartbeat_ns = strtoull(optarg, NULL, 10) * 1000000000ull;
+            if (deadband.heartbeat_ns == 0) {
+                print_usage(argv[0]);
+                return 1;
+            }
+            break;
+        default:
+            print_usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    /* Everything the sampling path needs is allocated here, before any output */
+    Arena arena;
+    if (arena_init(&arena, ARENA_SIZE) != 0) {
+        return 1;
+    }
+    char *stdout_buffer = arena_alloc(&arena, STDOUT_BUFFER_SIZE);
+    if (!stdout_buffer || setvbuf(stdout, stdout_buffer, _IOFBF, STDOUT_BUFFER_SIZE) != 0) {
+        arena_release(&arena);
+        return 1;
+    }
+
+    /* In sampling mode stdout carries only samples; status lines go to stderr */
+    FILE *info = interval_ms > 0 ? stderr : stdout;
+
+    if (interval_ms == 0) {
+        printf("=================================================\n");
+        printf("NVIDIA GPU Stats Reader\n");
+        printf("Using undocumented NVAPI calls from libnvidia-api.so.1\n");
+        printf("=================================================\n\n");
+    }
 
     /* Load NVAPI library */
     if (load_nvapi() != 0) {
+        close_output(&arena);
         return 1;
     }
 
     /* Initialize NVAPI */
     if (init_nvapi() != 0) {
         dlclose(nvapi_lib);
+        close_output(&arena);
+        return 1;
+    }
+    fprintf(info, "NVAPI initialized successfully.\n\n");
+
+    if (resolve_nvapi_functions() != 0) {
+        unload_nvapi();
+        close_output(&arena);
         return 1;
     }
 
@@ -296,10 +816,17 @@ int main(void) {
 
     if (enum_physical_gpus(handles, &gpu_count) != 0) {
         unload_nvapi();
+        close_output(&arena);
         return 1;
     }
 
-    printf("Found %u NVIDIA GPU(s)\n\n", gpu_count);
+    fprintf(info, "Found %u NVIDIA GPU(s)\n\n", gpu_count);
+
+    if (interval_ms > 0) {
+        int rc = run_sampling_loop(handles, gpu_count, &arena, interval_ms, max_ticks, &deadband);
+        unload_nvapi();
+        return (close_output(&arena) == 0 && rc == 0) ? 0 : 1;
+    }
 
     /* Get stats for each GPU */
     for (uint32_t i = 0; i < gpu_count; i++) {
@@ -348,5 +875,5 @@ int main(void) {
     unload_nvapi();
     printf("Done.\n");
 
-    return 0;
-}
\ No newline at end of file
+    return close_output(&arena) == 0 ? 0 : 1;
+}
@@ -0,0 +1,174 @@
+/*
+ * Telemetry Kernel Benchmark
+ *
+ * Times every kernel of telemetry_kernels.c in each instruction set the CPU
+ * supports on a large synthetic trace, checks that the vector versions give
+ * the same results as the scalar one, and prints the speedup over scalar.
+ *
+ * The trace looks like a recording: a temperature random walk in 1/256 °C
+ * (runs of equal values, small steps), delta-encoded as the columnar
+ * recorder stores it, with a few missing (TK_NULL) values.
+ *
+ * Compile: gcc -O2 -o telemetry_bench telemetry_bench.c telemetry_kernels.c
+ * Run:     ./telemetry_bench [-n values] [-r repeats]
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "telemetry_kernels.h"
+
+#define DEFAULT_VALUES (64u << 20)
+#define DEFAULT_REPEATS 5
+#define HIST_BINS 2048
+#define HIST_SHIFT 4          /* 1/16 °C bins */
+#define HIST_LOW (20 * 256)
+
+static const char *isas[] = { "scalar", "sse4", "avx2" };
+
+typedef struct {
+    double decode, scale, histogram, stats;   /* Best time in seconds */
+} timings;
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint64_t rng_state = 0x9e3779b97f4a7c15ULL;
+
+static uint32_t next_random(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return (uint32_t)rng_state;
+}
+
+/* Temperature random walk between 30 and 90 °C, stored as deltas */
+static void make_trace(int32_t *deltas, size_t n) {
+    int32_t value = 50 * 256, previous = 0;
+    for (size_t i = 0; i < n; i++) {
+        uint32_t r = next_random();
+        if (r % 8 == 0) {
+            value += (int32_t)(r >> 8) % 129 - 64;   /* Up to a quarter degree */
+            if (value < 30 * 256) value = 30 * 256;
+            if (value > 90 * 256) value = 90 * 256;
+        }
+        int32_t stored = (r >> 3) % 4096 == 0 ? TK_NULL : value;
+        deltas[i] = (int32_t)((uint32_t)stored - (uint32_t)previous);
+        previous = stored;
+    }
+}
+
+static void run(const char *isa, const int32_t *deltas, int32_t *decoded, float *scaled, uint32_t *bins,
+                size_t n, int repeats, timings *best) {
+    best->decode = best->scale = best->histogram = best->stats = 1e30;
+    tk_select(isa);
+    for (int r = 0; r < repeats; r++) {
+        double t = now();
+        tk_decode_deltas(deltas, decoded, n);
+        double t1 = now();
+        tk_scale(decoded, scaled, n, 1.0f / 256);
+        double t2 = now();
+        memset(bins, 0, HIST_BINS * sizeof(uint32_t));
+        tk_histogram(decoded, n, HIST_LOW, HIST_SHIFT, bins, HIST_BINS);
+        double t3 = now();
+        tk_summary summary;
+        tk_stats(decoded, n, &summary);
+        double t4 = now();
+        if (t1 - t < best->decode) best->decode = t1 - t;
+        if (t2 - t1 < best->scale) best->scale = t2 - t1;
+        if (t3 - t2 < best->histogram) best->histogram = t3 - t2;
+        if (t4 - t3 < best->stats) best->stats = t4 - t3;
+    }
+}
+
+static void print_usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-n values] [-r repeats]\n", prog);
+    fprintf(stderr, "  -n values    Trace length (default %u)\n", DEFAULT_VALUES);
+    fprintf(stderr, "  -r repeats   Runs per kernel; the fastest is reported (default %d)\n", DEFAULT_REPEATS);
+}
+
+int main(int argc, char **argv) {
+    size_t n = DEFAULT_VALUES;
+    int repeats = DEFAULT_REPEATS;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:r:h")) != -1) {
+        switch (opt) {
+        case 'n':
+            n = strtoull(optarg, NULL, 10);
+            break;
+        case 'r':
+            repeats = atoi(optarg);
+            break;
+        default:
+            print_usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (n == 0 || repeats < 1) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    int32_t *deltas = malloc(n * sizeof(int32_t));
+    int32_t *decoded = malloc(n * sizeof(int32_t));
+    float *scaled = malloc(n * sizeof(float));
+    int32_t *reference = malloc(n * sizeof(int32_t));
+    float *reference_scaled = malloc(n * sizeof(float));
+    uint32_t bins[HIST_BINS], reference_bins[HIST_BINS];
+    if (deltas == NULL || decoded == NULL || scaled == NULL || reference == NULL || reference_scaled == NULL) {
+        fprintf(stderr, "Error: Could not allocate buffers for %zu values\n", n);
+        return 1;
+    }
+    make_trace(deltas, n);
+    printf("Kernel benchmark: %zu values (%.0f MB per column), best of %d\n", n, n * 4 / 1e6, repeats);
+    printf("%-8s %12s %12s %12s %12s   (ns per value)\n", "isa", "decode", "scale/256", "histogram", "min/max/sum");
+
+    timings scalar;
+    tk_summary reference_summary;
+    int failed = 0;
+    for (size_t k = 0; k < sizeof(isas) / sizeof(isas[0]); k++) {
+        if (tk_select(isas[k]) != 0) {
+            printf("%-8s (not supported by this CPU)\n", isas[k]);
+            continue;
+        }
+        timings t;
+        run(isas[k], deltas, decoded, scaled, bins, n, repeats, &t);
+        tk_summary summary;
+        tk_stats(decoded, n, &summary);
+        if (k == 0) {
+            scalar = t;
+            memcpy(reference, decoded, n * sizeof(int32_t));
+            memcpy(reference_scaled, scaled, n * sizeof(float));
+            memcpy(reference_bins, bins, sizeof(bins));
+            reference_summary = summary;
+        } else if (memcmp(reference, decoded, n * sizeof(int32_t)) != 0 ||
+                   memcmp(reference_scaled, scaled, n * sizeof(float)) != 0 ||
+                   memcmp(reference_bins, bins, sizeof(bins)) != 0 ||
+                   memcmp(&reference_summary, &summary, sizeof(summary)) != 0) {
+            printf("%-8s MISMATCH with scalar results\n", isas[k]);
+            failed = 1;
+            continue;
+        }
+        printf("%-8s %12.3f %12.3f %12.3f %12.3f\n", isas[k], t.decode * 1e9 / n, t.scale * 1e9 / n,
+               t.histogram * 1e9 / n, t.stats * 1e9 / n);
+        if (k > 0) {
+            printf("%-8s %11.2fx %11.2fx %11.2fx %11.2fx\n", "", scalar.decode / t.decode,
+                   scalar.scale / t.scale, scalar.histogram / t.histogram, scalar.stats / t.stats);
+        }
+    }
+
+    free(deltas);
+    free(decoded);
+    free(scaled);
+    free(reference);
+    free(reference_scaled);
+    return failed;
+}
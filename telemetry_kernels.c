@@ -0,0 +1,399 @@
+/*
+ * Telemetry Kernels
+ *
+ * Scalar, SSE4.1 and AVX2 versions of the inner loops every analysis of a
+ * columnar recording runs: prefix-sum delta decode, fixed-point scaling,
+ * histogram binning and min/max/sum. See telemetry_kernels.h.
+ *
+ * Delta decode is a running sum, which does not vectorize by itself: each
+ * vector is turned into its own prefix sum with two shifted adds (plus one
+ * cross-lane add for AVX2), and the last element is broadcast as the carry
+ * into the next vector. Histograms compute bin indices and the range check
+ * in vector registers, then count into four interleaved sub-histograms, so
+ * that runs of equal values (a steady temperature) do not serialize on one
+ * counter through store-to-load forwarding.
+ *
+ * Compile together with its users, e.g.
+ *   gcc -O2 -o telemetry_bench telemetry_bench.c telemetry_kernels.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "telemetry_kernels.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define TK_X86 1
+#include <immintrin.h>
+#endif
+
+#define TK_LOCAL_BINS 4096   /* Largest histogram counted through sub-histograms */
+
+typedef struct {
+    const char *name;
+    void (*decode)(const int32_t *deltas, int32_t *out, size_t n);
+    void (*scale)(const int32_t *in, float *out, size_t n, float scale);
+    size_t (*histogram)(const int32_t *values, size_t n, int32_t low, unsigned shift,
+                        uint32_t *bins, uint32_t bin_count);
+    void (*stats)(const int32_t *values, size_t n, tk_summary *summary);
+} kernel_set;
+
+/* ===== Scalar ===== */
+
+static void decode_scalar(const int32_t *deltas, int32_t *out, size_t n) {
+    uint32_t value = 0;
+    for (size_t i = 0; i < n; i++) {
+        value += (uint32_t)deltas[i];
+        out[i] = (int32_t)value;
+    }
+}
+
+static void scale_scalar(const int32_t *in, float *out, size_t n, float scale) {
+    for (size_t i = 0; i < n; i++) {
+        out[i] = (float)in[i] * scale;
+    }
+}
+
+/* Values at or beyond the limit (including wrapped negatives) are out of range */
+static uint64_t histogram_limit(uint32_t bin_count, unsigned shift) {
+    return (uint64_t)bin_count << shift;
+}
+
+static size_t histogram_scalar(const int32_t *values, size_t n, int32_t low, unsigned shift,
+                               uint32_t *bins, uint32_t bin_count) {
+    uint64_t limit = histogram_limit(bin_count, shift);
+    size_t counted = 0;
+    for (size_t i = 0; i < n; i++) {
+        uint32_t u = (uint32_t)values[i] - (uint32_t)low;
+        if (u < limit) {
+            bins[u >> shift]++;
+            counted++;
+        }
+    }
+    return counted;
+}
+
+static void stats_scalar(const int32_t *values, size_t n, tk_summary *summary) {
+    int32_t min = INT32_MAX, max = INT32_MIN;
+    int64_t sum = 0;
+    size_t count = 0;
+    for (size_t i = 0; i < n; i++) {
+        int32_t x = values[i];
+        if (x == TK_NULL) {
+            continue;
+        }
+        if (x < min) min = x;
+        if (x > max) max = x;
+        sum += x;
+        count++;
+    }
+    summary->min = min;
+    summary->max = max;
+    summary->sum = sum;
+    summary->count = count;
+}
+
+static const kernel_set scalar_kernels = {
+    "scalar", decode_scalar, scale_scalar, histogram_scalar, stats_scalar
+};
+
+#ifdef TK_X86
+
+/* Count precomputed bin indices (bin_count = out of range) into four sub-histograms and fold them */
+#define COUNT_INDICES(lanes, width)                                 \
+    for (int l = 0; l < (width); l += 4) {                          \
+        local[0][lanes[l]]++;                                       \
+        local[1][lanes[l + 1]]++;                                   \
+        local[2][lanes[l + 2]]++;                                   \
+        local[3][lanes[l + 3]]++;                                   \
+    }
+
+static size_t fold_histogram(uint32_t (*local)[TK_LOCAL_BINS + 1], uint32_t *bins, uint32_t bin_count,
+                             size_t vector_values) {
+    size_t discarded = 0;
+    for (uint32_t b = 0; b < bin_count; b++) {
+        bins[b] += local[0][b] + local[1][b] + local[2][b] + local[3][b];
+    }
+    for (int k = 0; k < 4; k++) {
+        discarded += local[k][bin_count];
+    }
+    return vector_values - discarded;
+}
+
+/* ===== SSE4.1 ===== */
+
+__attribute__((target("sse4.1")))
+static void decode_sse4(const int32_t *deltas, int32_t *out, size_t n) {
+    __m128i carry = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(deltas + i));
+        x = _mm_add_epi32(x, _mm_slli_si128(x, 4));
+        x = _mm_add_epi32(x, _mm_slli_si128(x, 8));
+        x = _mm_add_epi32(x, carry);
+        _mm_storeu_si128((__m128i *)(out + i), x);
+        carry = _mm_shuffle_epi32(x, 0xFF);
+    }
+    uint32_t value = (uint32_t)_mm_cvtsi128_si32(carry);
+    for (; i < n; i++) {
+        value += (uint32_t)deltas[i];
+        out[i] = (int32_t)value;
+    }
+}
+
+__attribute__((target("sse4.1")))
+static void scale_sse4(const int32_t *in, float *out, size_t n, float scale) {
+    __m128 factor = _mm_set1_ps(scale);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 x = _mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *)(in + i)));
+        _mm_storeu_ps(out + i, _mm_mul_ps(x, factor));
+    }
+    scale_scalar(in + i, out + i, n - i, scale);
+}
+
+__attribute__((target("sse4.1")))
+static size_t histogram_sse4(const int32_t *values, size_t n, int32_t low, unsigned shift,
+                             uint32_t *bins, uint32_t bin_count) {
+    uint64_t limit = histogram_limit(bin_count, shift);
+    if (bin_count > TK_LOCAL_BINS || n < bin_count) {
+        return histogram_scalar(values, n, low, shift, bins, bin_count);  /* Not worth clearing sub-histograms */
+    }
+    uint32_t local[4][TK_LOCAL_BINS + 1];
+    for (int k = 0; k < 4; k++) {
+        memset(local[k], 0, (bin_count + 1) * sizeof(uint32_t));
+    }
+    __m128i base = _mm_set1_epi32(low);
+    __m128i last = _mm_set1_epi32((int32_t)(limit > UINT32_MAX ? UINT32_MAX : limit - 1));
+    __m128i overflow = _mm_set1_epi32((int32_t)bin_count);
+    __m128i count = _mm_cvtsi32_si128((int)shift);
+    uint32_t lanes[4];
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i u = _mm_sub_epi32(_mm_loadu_si128((const __m128i *)(values + i)), base);
+        __m128i in_range = _mm_cmpeq_epi32(_mm_min_epu32(u, last), u);
+        __m128i index = _mm_blendv_epi8(overflow, _mm_srl_epi32(u, count), in_range);
+        _mm_storeu_si128((__m128i *)lanes, index);
+        COUNT_INDICES(lanes, 4);
+    }
+    size_t counted = fold_histogram(local, bins, bin_count, i);
+    return counted + histogram_scalar(values + i, n - i, low, shift, bins, bin_count);
+}
+
+__attribute__((target("sse4.1")))
+static void stats_sse4(const int32_t *values, size_t n, tk_summary *summary) {
+    __m128i null = _mm_set1_epi32(TK_NULL), top = _mm_set1_epi32(INT32_MAX);
+    __m128i min = top, max = null, sum = _mm_setzero_si128(), nulls = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(values + i));
+        __m128i is_null = _mm_cmpeq_epi32(x, null);
+        nulls = _mm_sub_epi32(nulls, is_null);  /* Per-lane counts; a lane sees n / 4 values */
+        min = _mm_min_epi32(min, _mm_blendv_epi8(x, top, is_null));
+        max = _mm_max_epi32(max, x);  /* TK_NULL is INT32_MIN, never a maximum */
+        x = _mm_andnot_si128(is_null, x);
+        sum = _mm_add_epi64(sum, _mm_cvtepi32_epi64(x));
+        sum = _mm_add_epi64(sum, _mm_cvtepi32_epi64(_mm_srli_si128(x, 8)));
+    }
+    tk_summary tail;
+    stats_scalar(values + i, n - i, &tail);
+    int32_t mins[4], maxs[4];
+    uint32_t null_counts[4];
+    int64_t sums[2];
+    _mm_storeu_si128((__m128i *)mins, min);
+    _mm_storeu_si128((__m128i *)maxs, max);
+    _mm_storeu_si128((__m128i *)null_counts, nulls);
+    _mm_storeu_si128((__m128i *)sums, sum);
+    size_t count = tail.count + i;
+    for (int l = 0; l < 4; l++) {
+        if (mins[l] < tail.min) tail.min = mins[l];
+        if (maxs[l] > tail.max) tail.max = maxs[l];
+        count -= null_counts[l];
+    }
+    summary->min = tail.min;
+    summary->max = tail.max;
+    summary->sum = tail.sum + sums[0] + sums[1];
+    summary->count = count;
+}
+
+static const kernel_set sse4_kernels = {
+    "sse4", decode_sse4, scale_sse4, histogram_sse4, stats_sse4
+};
+
+/* ===== AVX2 ===== */
+
+__attribute__((target("avx2")))
+static void decode_avx2(const int32_t *deltas, int32_t *out, size_t n) {
+    __m256i carry = _mm256_setzero_si256();
+    __m256i broadcast_last = _mm256_set1_epi32(7);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(deltas + i));
+        /* Prefix sums within each 128-bit lane, then carry the low lane's total into the high lane */
+        x = _mm256_add_epi32(x, _mm256_slli_si256(x, 4));
+        x = _mm256_add_epi32(x, _mm256_slli_si256(x, 8));
+        __m256i low_total = _mm256_shuffle_epi32(_mm256_permute2x128_si256(x, x, 0x08), 0xFF);
+        x = _mm256_add_epi32(x, low_total);
+        x = _mm256_add_epi32(x, carry);
+        _mm256_storeu_si256((__m256i *)(out + i), x);
+        carry = _mm256_permutevar8x32_epi32(x, broadcast_last);
+    }
+    uint32_t value = (uint32_t)_mm256_cvtsi256_si32(carry);
+    for (; i < n; i++) {
+        value += (uint32_t)deltas[i];
+        out[i] = (int32_t)value;
+    }
+}
+
+__attribute__((target("avx2")))
+static void scale_avx2(const int32_t *in, float *out, size_t n, float scale) {
+    __m256 factor = _mm256_set1_ps(scale);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 x = _mm256_cvtepi32_ps(_mm256_loadu_si256((const __m256i *)(in + i)));
+        _mm256_storeu_ps(out + i, _mm256_mul_ps(x, factor));
+    }
+    scale_scalar(in + i, out + i, n - i, scale);
+}
+
+__attribute__((target("avx2")))
+static size_t histogram_avx2(const int32_t *values, size_t n, int32_t low, unsigned shift,
+                             uint32_t *bins, uint32_t bin_count) {
+    uint64_t limit = histogram_limit(bin_count, shift);
+    if (bin_count > TK_LOCAL_BINS || n < bin_count) {
+        return histogram_scalar(values, n, low, shift, bins, bin_count);
+    }
+    uint32_t local[4][TK_LOCAL_BINS + 1];
+    for (int k = 0; k < 4; k++) {
+        memset(local[k], 0, (bin_count + 1) * sizeof(uint32_t));
+    }
+    __m256i base = _mm256_set1_epi32(low);
+    __m256i last = _mm256_set1_epi32((int32_t)(limit > UINT32_MAX ? UINT32_MAX : limit - 1));
+    __m256i overflow = _mm256_set1_epi32((int32_t)bin_count);
+    __m128i count = _mm_cvtsi32_si128((int)shift);
+    uint32_t lanes[8];
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i u = _mm256_sub_epi32(_mm256_loadu_si256((const __m256i *)(values + i)), base);
+        __m256i in_range = _mm256_cmpeq_epi32(_mm256_min_epu32(u, last), u);
+        __m256i index = _mm256_blendv_epi8(overflow, _mm256_srl_epi32(u, count), in_range);
+        _mm256_storeu_si256((__m256i *)lanes, index);
+        COUNT_INDICES(lanes, 8);
+    }
+    size_t counted = fold_histogram(local, bins, bin_count, i);
+    return counted + histogram_scalar(values + i, n - i, low, shift, bins, bin_count);
+}
+
+__attribute__((target("avx2")))
+static void stats_avx2(const int32_t *values, size_t n, tk_summary *summary) {
+    __m256i null = _mm256_set1_epi32(TK_NULL), top = _mm256_set1_epi32(INT32_MAX);
+    __m256i min = top, max = null, sum = _mm256_setzero_si256(), nulls = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(values + i));
+        __m256i is_null = _mm256_cmpeq_epi32(x, null);
+        nulls = _mm256_sub_epi32(nulls, is_null);
+        min = _mm256_min_epi32(min, _mm256_blendv_epi8(x, top, is_null));
+        max = _mm256_max_epi32(max, x);
+        x = _mm256_andnot_si256(is_null, x);
+        sum = _mm256_add_epi64(sum, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(x)));
+        sum = _mm256_add_epi64(sum, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(x, 1)));
+    }
+    tk_summary tail;
+    stats_scalar(values + i, n - i, &tail);
+    int32_t mins[8], maxs[8];
+    uint32_t null_counts[8];
+    int64_t sums[4];
+    _mm256_storeu_si256((__m256i *)mins, min);
+    _mm256_storeu_si256((__m256i *)maxs, max);
+    _mm256_storeu_si256((__m256i *)null_counts, nulls);
+    _mm256_storeu_si256((__m256i *)sums, sum);
+    size_t count = tail.count + i;
+    for (int l = 0; l < 8; l++) {
+        if (mins[l] < tail.min) tail.min = mins[l];
+        if (maxs[l] > tail.max) tail.max = maxs[l];
+        count -= null_counts[l];
+    }
+    summary->min = tail.min;
+    summary->max = tail.max;
+    summary->sum = tail.sum + sums[0] + sums[1] + sums[2] + sums[3];
+    summary->count = count;
+}
+
+static const kernel_set avx2_kernels = {
+    "avx2", decode_avx2, scale_avx2, histogram_avx2, stats_avx2
+};
+
+#endif /* TK_X86 */
+
+/* ===== Dispatch ===== */
+
+static const kernel_set *active_kernels = NULL;
+
+static const kernel_set *find_kernels(const char *isa) {
+    if (strcmp(isa, "scalar") == 0) {
+        return &scalar_kernels;
+    }
+#ifdef TK_X86
+    __builtin_cpu_init();
+    if (strcmp(isa, "sse4") == 0 && __builtin_cpu_supports("sse4.1")) {
+        return &sse4_kernels;
+    }
+    if (strcmp(isa, "avx2") == 0 && __builtin_cpu_supports("avx2")) {
+        return &avx2_kernels;
+    }
+#endif
+    return NULL;
+}
+
+static const kernel_set *kernels(void) {
+    /* Every thread that races here picks the same set, so a plain atomic store is enough */
+    const kernel_set *set = __atomic_load_n(&active_kernels, __ATOMIC_ACQUIRE);
+    if (set != NULL) {
+        return set;
+    }
+    const char *isa = getenv("TK_ISA");
+    if (isa != NULL && (set = find_kernels(isa)) == NULL) {
+        fprintf(stderr, "Warning: TK_ISA=%s is unknown or unsupported by this CPU\n", isa);
+    }
+    if (set == NULL && (set = find_kernels("avx2")) == NULL && (set = find_kernels("sse4")) == NULL) {
+        set = &scalar_kernels;
+    }
+    __atomic_store_n(&active_kernels, set, __ATOMIC_RELEASE);
+    return set;
+}
+
+int tk_select(const char *isa) {
+    const kernel_set *set = find_kernels(isa);
+    if (set == NULL) {
+        return -1;
+    }
+    __atomic_store_n(&active_kernels, set, __ATOMIC_RELEASE);
+    return 0;
+}
+
+const char *tk_isa(void) {
+    return kernels()->name;
+}
+
+void tk_decode_deltas(const int32_t *deltas, int32_t *out, size_t n) {
+    kernels()->decode(deltas, out, n);
+}
+
+void tk_scale(const int32_t *in, float *out, size_t n, float scale) {
+    kernels()->scale(in, out, n, scale);
+}
+
+size_t tk_histogram(const int32_t *values, size_t n, int32_t low, unsigned shift,
+                    uint32_t *bins, uint32_t bin_count) {
+    if (bin_count == 0 || shift > 31) {
+        return 0;
+    }
+    return kernels()->histogram(values, n, low, shift, bins, bin_count);
+}
+
+void tk_stats(const int32_t *values, size_t n, tk_summary *summary) {
+    kernels()->stats(values, n, summary);
+}
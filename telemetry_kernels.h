@@ -0,0 +1,51 @@
+/*
+ * Telemetry Kernels - vectorized inner loops over recorded columns
+ *
+ * Delta decode, fixed-point scaling, histogram binning and min/max/sum over
+ * int32 columns as stored by the columnar recorder. Each kernel has a scalar,
+ * an SSE4.1 and an AVX2 version; the best one the CPU supports is chosen on
+ * first use (override with TK_ISA=scalar|sse4|avx2 in the environment, or
+ * tk_select()). All versions produce bit-identical results.
+ *
+ * No -m flags are needed: the vector versions are compiled with target
+ * attributes, so one binary runs on any x86-64 CPU. On other architectures
+ * only the scalar versions are built.
+ */
+
+#ifndef TELEMETRY_KERNELS_H
+#define TELEMETRY_KERNELS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define TK_NULL INT32_MIN   /* Missing value, skipped by tk_stats (same as TQ_NULL) */
+
+/* Running prefix sum with wrapping arithmetic: out[i] = deltas[0] + ... + deltas[i] */
+void tk_decode_deltas(const int32_t *deltas, int32_t *out, size_t n);
+
+/* out[i] = in[i] * scale, e.g. scale 1/256.0f for NVAPI fixed-point temperatures */
+void tk_scale(const int32_t *in, float *out, size_t n, float scale);
+
+/*
+ * Add values into bins[(value - low) >> shift], for bins of 2^shift stored
+ * units (shift < 32). Values outside [low, low + (bin_count << shift)) are
+ * not counted. Returns the number of values counted.
+ */
+size_t tk_histogram(const int32_t *values, size_t n, int32_t low, unsigned shift,
+                    uint32_t *bins, uint32_t bin_count);
+
+/* Min, max and sum of the values that are not TK_NULL; count is how many there were */
+typedef struct {
+    int32_t min, max;
+    int64_t sum;
+    size_t count;
+} tk_summary;
+
+void tk_stats(const int32_t *values, size_t n, tk_summary *summary);
+
+/* Force a kernel set ("scalar", "sse4", "avx2"); -1 if unknown or unsupported */
+int tk_select(const char *isa);
+/* Name of the kernel set in use */
+const char *tk_isa(void);
+
+#endif /* TELEMETRY_KERNELS_H */
@@ -0,0 +1,1110 @@
+/*
+ * Telemetry Query Engine
+ *
+ * Answers questions like "p99 temperature in P0, per 60 MHz frequency bin,
+ * over the last week" directly from columnar recordings written by
+ * gpu_offset_control_v2 (record_format 'columnar'), without loading them
+ * into an analysis tool first.
+ *
+ * The recording is memory-mapped and indexed by its block headers only.
+ * A block whose per-column min/max rules out a filter (or the time range)
+ * is skipped without reading its data. The rest are handed out one at a
+ * time to worker threads, which decode only the columns the query needs,
+ * narrow a selection vector filter by filter and aggregate into their own
+ * group table; the tables are merged once all blocks are done. Decoding,
+ * and the aggregation of blocks that fall entirely into one group, run
+ * through the vector kernels of telemetry_kernels.c. Percentiles come from
+ * per-group histograms over the column's range in the file with power-of-two
+ * bins: exact for whole-degree temperatures, MHz and P-states, otherwise
+ * rounded down to the bin width (e.g. 0.128 W over a 0-250 W range).
+ *
+ * File format (little-endian, see ColumnarRecorder in gpu_offset_control_v2):
+ *   header  "GTRC" u32 version u32 columns u32 block_rows i64 created_ms, 8 pad
+ *   record  char tag[4] u32 length, payload padded to 8 bytes
+ *     "BLK1"  u32 rows u32 0 i64 t0_ms i32 min[columns] i32 max[columns]
+ *             i32 data[columns][rows] (each column delta-encoded, wrapping)
+ *     "DIC1"  u32 profile_id u32 length char name[length]
+ *
+ * Compile: gcc -O2 -o telemetry_query telemetry_query.c telemetry_kernels.c -pthread -lm
+ * Run:     ./telemetry_query -i gpu.gtr
+ *          ./telemetry_query -w pstate=0 -g frequency:60 -a p99:temperature -s 604800 gpu.gtr
+ *          ./telemetry_query -b 3600 -a mean:power -a max:temperature -w profile=quiet gpu.gtr
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "telemetry_query.h"
+#include "telemetry_kernels.h"
+
+#define TQ_MAGIC "GTRC"
+#define TQ_VERSION 1
+#define TQ_HEADER_SIZE 32
+#define TQ_RECORD_SIZE 8
+#define TQ_BLOCK_HEADER_SIZE (16 + 8 * TQ_COLUMNS)
+#define TQ_HIST_BINS 2048
+#define TQ_INITIAL_GROUPS 64
+
+static const char *column_names[TQ_COLUMNS] = {
+    "time", "gpu", "temperature", "power", "frequency", "pstate", "voltage", "offset", "profile"
+};
+
+/* Stored units per user unit */
+static const double column_scales[TQ_COLUMNS] = { 1, 1, 256, 1000, 1, 1, 1e6, 1, 1 };
+
+static __thread char error_message[256];
+
+static int fail(const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    vsnprintf(error_message, sizeof(error_message), format, args);
+    va_end(args);
+    return -1;
+}
+
+const char *tq_error(void) {
+    return error_message;
+}
+
+/* ===== Columns and query parsing ===== */
+
+int tq_column(const char *name) {
+    for (int i = 0; i < TQ_COLUMNS; i++) {
+        if (strcmp(name, column_names[i]) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+const char *tq_column_name(int column) {
+    return column >= 0 && column < TQ_COLUMNS ? column_names[column] : "?";
+}
+
+int32_t tq_to_stored(int column, double value) {
+    double stored = round(value * column_scales[column]);
+    if (stored <= (double)TQ_NULL) {
+        return TQ_NULL + 1;
+    }
+    if (stored >= (double)INT32_MAX) {
+        return INT32_MAX;
+    }
+    return (int32_t)stored;
+}
+
+double tq_from_stored(int column, double value) {
+    return value / column_scales[column];
+}
+
+int tq_parse_filter(const tq_file *file, const char *expr, tq_filter *filter) {
+    static const struct { const char *text; tq_op op; } ops[] = {
+        { "<=", TQ_LE }, { ">=", TQ_GE }, { "!=", TQ_NE }, { "==", TQ_EQ },
+        { "<", TQ_LT }, { ">", TQ_GT }, { "=", TQ_EQ },
+    };
+    size_t name_length = strcspn(expr, "<>=!");
+    char name[32];
+    if (name_length == 0 || name_length >= sizeof(name)) {
+        return fail("cannot parse filter '%s'", expr);
+    }
+    memcpy(name, expr, name_length);
+    name[name_length] = '\0';
+    filter->column = tq_column(name);
+    if (filter->column < 0 || filter->column == TQ_TIME) {
+        return fail("unknown filter column '%s' (use -s/-S/-E for time)", name);
+    }
+    const char *rest = expr + name_length;
+    const char *value = NULL;
+    for (size_t i = 0; i < sizeof(ops) / sizeof(ops[0]); i++) {
+        size_t length = strlen(ops[i].text);
+        if (strncmp(rest, ops[i].text, length) == 0) {
+            filter->op = ops[i].op;
+            value = rest + length;
+            break;
+        }
+    }
+    if (value == NULL || *value == '\0') {
+        return fail("cannot parse filter '%s'", expr);
+    }
+    if (filter->column == TQ_PROFILE) {
+        /* Profiles are matched by name; a name the file never used matches nothing */
+        filter->value = -1;
+        for (uint32_t i = 0; file != NULL && i < file->profile_count; i++) {
+            if (file->profiles[i] != NULL && strcmp(file->profiles[i], value) == 0) {
+                filter->value = (int32_t)i;
+            }
+        }
+        if (filter->op != TQ_EQ && filter->op != TQ_NE) {
+            return fail("profile filters support = and != only");
+        }
+        return 0;
+    }
+    char *end;
+    double number = strtod(value, &end);
+    if (end == value || *end != '\0') {
+        return fail("cannot parse filter value '%s'", value);
+    }
+    filter->value = tq_to_stored(filter->column, number);
+    return 0;
+}
+
+int tq_parse_aggregate(const char *spec, tq_aggregate *aggregate) {
+    static const struct { const char *name; tq_aggregate_kind kind; } kinds[] = {
+        { "min", TQ_MIN }, { "max", TQ_MAX }, { "mean", TQ_MEAN }, { "sum", TQ_SUM },
+    };
+    aggregate->column = -1;
+    aggregate->percentile = 0;
+    if (strcmp(spec, "count") == 0) {
+        aggregate->kind = TQ_COUNT;
+        return 0;
+    }
+    const char *colon = strchr(spec, ':');
+    if (colon == NULL) {
+        return fail("aggregate '%s' needs a column, e.g. mean:power", spec);
+    }
+    aggregate->column = tq_column(colon + 1);
+    if (aggregate->column < 0 || aggregate->column == TQ_TIME) {
+        return fail("cannot aggregate column '%s'", colon + 1);
+    }
+    size_t length = (size_t)(colon - spec);
+    for (size_t i = 0; i < sizeof(kinds) / sizeof(kinds[0]); i++) {
+        if (strlen(kinds[i].name) == length && strncmp(spec, kinds[i].name, length) == 0) {
+            aggregate->kind = kinds[i].kind;
+            return 0;
+        }
+    }
+    if (spec[0] == 'p' && length > 1) {
+        char *end;
+        double percentile = strtod(spec + 1, &end);
+        if (end == colon && percentile >= 0 && percentile <= 100) {
+            aggregate->kind = TQ_PERCENTILE;
+            aggregate->percentile = percentile;
+            return 0;
+        }
+    }
+    return fail("unknown aggregate '%.*s' (count, min, max, mean, sum, pNN)", (int)length, spec);
+}
+
+int tq_parse_group(const char *spec, tq_query *query) {
+    char name[32];
+    const char *colon = strchr(spec, ':');
+    size_t length = colon != NULL ? (size_t)(colon - spec) : strlen(spec);
+    if (length == 0 || length >= sizeof(name)) {
+        return fail("cannot parse group '%s'", spec);
+    }
+    memcpy(name, spec, length);
+    name[length] = '\0';
+    query->group_column = tq_column(name);
+    if (query->group_column < 0 || query->group_column == TQ_TIME) {
+        return fail("cannot group by '%s' (use -b for time buckets)", name);
+    }
+    query->group_width = 1;
+    if (colon != NULL) {
+        double width = strtod(colon + 1, NULL);
+        query->group_width = tq_to_stored(query->group_column, width);
+        if (query->group_width < 1 || query->group_column == TQ_PROFILE) {
+            return fail("invalid bin width in '%s'", spec);
+        }
+    }
+    return 0;
+}
+
+/* ===== File ===== */
+
+int tq_open(tq_file *file, const char *path) {
+    memset(file, 0, sizeof(*file));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return fail("%s: %s", path, strerror(errno));
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < TQ_HEADER_SIZE) {
+        close(fd);
+        return fail("%s: not a columnar recording", path);
+    }
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return fail("%s: mmap failed: %s", path, strerror(errno));
+    }
+    file->map = map;
+    file->size = (size_t)st.st_size;
+
+    uint32_t version, columns;
+    memcpy(&version, file->map + 4, 4);
+    memcpy(&columns, file->map + 8, 4);
+    if (memcmp(file->map, TQ_MAGIC, 4) != 0 || version != TQ_VERSION || columns != TQ_COLUMNS) {
+        tq_close(file);
+        return fail("%s: not a version %d columnar recording", path, TQ_VERSION);
+    }
+
+    size_t capacity = 0;
+    for (int c = 0; c < TQ_COLUMNS; c++) {
+        file->min[c] = INT32_MAX;
+        file->max[c] = TQ_NULL;
+    }
+    file->first_ms = INT64_MAX;
+    file->last_ms = INT64_MIN;
+
+    /* A torn record at the end (recorder killed mid-write) ends the scan */
+    size_t pos = TQ_HEADER_SIZE;
+    while (pos + TQ_RECORD_SIZE <= file->size) {
+        const uint8_t *record = file->map + pos;
+        uint32_t length;
+        memcpy(&length, record + 4, 4);
+        size_t next = pos + TQ_RECORD_SIZE + (((size_t)length + 7) & ~(size_t)7);
+        if (next > file->size) {
+            break;
+        }
+        const uint8_t *payload = record + TQ_RECORD_SIZE;
+        if (memcmp(record, "BLK1", 4) == 0 && length >= TQ_BLOCK_HEADER_SIZE) {
+            tq_block block;
+            memcpy(&block.rows, payload, 4);
+            memcpy(&block.t0_ms, payload + 8, 8);
+            if (block.rows == 0 || length < TQ_BLOCK_HEADER_SIZE + (size_t)4 * TQ_COLUMNS * block.rows) {
+                pos = next;
+                continue;
+            }
+            block.min = (const int32_t *)(payload + 16);
+            block.max = block.min + TQ_COLUMNS;
+            block.data = block.max + TQ_COLUMNS;
+            if (file->block_count == capacity) {
+                capacity = capacity ? capacity * 2 : 1024;
+                tq_block *blocks = realloc(file->blocks, capacity * sizeof(tq_block));
+                if (blocks == NULL) {
+                    tq_close(file);
+                    return fail("out of memory indexing %s", path);
+                }
+                file->blocks = blocks;
+            }
+            file->blocks[file->block_count++] = block;
+            file->rows += block.rows;
+            if (block.rows > file->block_rows) {
+                file->block_rows = block.rows;
+            }
+            for (int c = 0; c < TQ_COLUMNS; c++) {
+                if (block.max[c] == TQ_NULL) {
+                    continue;  /* No values in this block */
+                }
+                if (block.min[c] < file->min[c]) file->min[c] = block.min[c];
+                if (block.max[c] > file->max[c]) file->max[c] = block.max[c];
+            }
+            if (block.t0_ms + block.min[TQ_TIME] < file->first_ms) file->first_ms = block.t0_ms + block.min[TQ_TIME];
+            if (block.t0_ms + block.max[TQ_TIME] > file->last_ms) file->last_ms = block.t0_ms + block.max[TQ_TIME];
+        } else if (memcmp(record, "DIC1", 4) == 0 && length >= 8) {
+            uint32_t id, name_length;
+            memcpy(&id, payload, 4);
+            memcpy(&name_length, payload + 4, 4);
+            if (name_length > length - 8 || id > 65535) {
+                pos = next;
+                continue;
+            }
+            if (id >= file->profile_count) {
+                char **profiles = realloc(file->profiles, (id + 1) * sizeof(char *));
+                if (profiles == NULL) {
+                    tq_close(file);
+                    return fail("out of memory indexing %s", path);
+                }
+                memset(profiles + file->profile_count, 0, (id + 1 - file->profile_count) * sizeof(char *));
+                file->profiles = profiles;
+                file->profile_count = id + 1;
+            }
+            free(file->profiles[id]);
+            file->profiles[id] = strndup((const char *)payload + 8, name_length);
+        }
+        pos = next;
+    }
+    for (int c = 0; c < TQ_COLUMNS; c++) {
+        if (file->max[c] == TQ_NULL) {
+            file->min[c] = TQ_NULL;
+        }
+    }
+    return 0;
+}
+
+void tq_close(tq_file *file) {
+    if (file->map != NULL) {
+        munmap((void *)file->map, file->size);
+    }
+    for (uint32_t i = 0; i < file->profile_count; i++) {
+        free(file->profiles[i]);
+    }
+    free(file->profiles);
+    free(file->blocks);
+    memset(file, 0, sizeof(*file));
+}
+
+/* ===== Group tables ===== */
+
+typedef struct {
+    int64_t sum;
+    uint64_t count;
+    int32_t min, max;
+    uint32_t *hist;     /* TQ_PERCENTILE only */
+} accumulator;
+
+typedef struct {
+    int64_t bucket;
+    int32_t group;
+    int used;
+    uint64_t rows;
+    accumulator acc[TQ_MAX_AGGREGATES];
+} group_entry;
+
+typedef struct {
+    group_entry *slots;
+    size_t capacity;    /* Power of two */
+    size_t count;
+} group_table;
+
+/* Histogram geometry of a percentile aggregate: bins of width = 1 << shift over [low, ...] */
+typedef struct {
+    int32_t low;
+    int32_t width;
+    unsigned shift;
+    uint32_t bins;
+} histogram_shape;
+
+typedef struct {
+    const tq_file *file;
+    const tq_query *query;
+    histogram_shape shapes[TQ_MAX_AGGREGATES];
+    int needed[TQ_COLUMNS];        /* Columns the query decodes */
+    size_t next_block;             /* Shared work counter */
+} plan;
+
+static uint64_t hash_key(int64_t bucket, int32_t group) {
+    uint64_t x = (uint64_t)bucket * 0x9e3779b97f4a7c15ULL ^ (uint32_t)group;
+    x ^= x >> 31;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    return x ^ (x >> 29);
+}
+
+static int table_init(group_table *table, size_t capacity) {
+    table->slots = calloc(capacity, sizeof(group_entry));
+    table->capacity = capacity;
+    table->count = 0;
+    return table->slots != NULL ? 0 : -1;
+}
+
+static void table_free(group_table *table) {
+    for (size_t i = 0; i < table->capacity; i++) {
+        if (table->slots[i].used) {
+            for (int a = 0; a < TQ_MAX_AGGREGATES; a++) {
+                free(table->slots[i].acc[a].hist);
+            }
+        }
+    }
+    free(table->slots);
+    table->slots = NULL;
+}
+
+static group_entry *table_slot(group_table *table, int64_t bucket, int32_t group) {
+    size_t mask = table->capacity - 1;
+    size_t i = hash_key(bucket, group) & mask;
+    while (table->slots[i].used && (table->slots[i].bucket != bucket || table->slots[i].group != group)) {
+        i = (i + 1) & mask;
+    }
+    return &table->slots[i];
+}
+
+/* Find or create a group; NULL when out of memory */
+static group_entry *table_get(group_table *table, const plan *p, int64_t bucket, int32_t group) {
+    group_entry *entry = table_slot(table, bucket, group);
+    if (entry->used) {
+        return entry;
+    }
+    if ((table->count + 1) * 2 > table->capacity) {
+        group_table grown;
+        if (table_init(&grown, table->capacity * 2) != 0) {
+            return NULL;
+        }
+        for (size_t i = 0; i < table->capacity; i++) {
+            if (table->slots[i].used) {
+                *table_slot(&grown, table->slots[i].bucket, table->slots[i].group) = table->slots[i];
+            }
+        }
+        grown.count = table->count;
+        free(table->slots);
+        *table = grown;
+        entry = table_slot(table, bucket, group);
+    }
+    entry->used = 1;
+    entry->bucket = bucket;
+    entry->group = group;
+    entry->rows = 0;
+    for (int a = 0; a < p->query->aggregate_count; a++) {
+        accumulator *acc = &entry->acc[a];
+        acc->sum = 0;
+        acc->count = 0;
+        acc->min = INT32_MAX;
+        acc->max = INT32_MIN;
+        acc->hist = NULL;
+        if (p->query->aggregates[a].kind == TQ_PERCENTILE) {
+            acc->hist = calloc(p->shapes[a].bins, sizeof(uint32_t));
+            if (acc->hist == NULL) {
+                return NULL;
+            }
+        }
+    }
+    table->count++;
+    return entry;
+}
+
+static int table_merge(group_table *into, group_table *from, const plan *p) {
+    for (size_t i = 0; i < from->capacity; i++) {
+        group_entry *source = &from->slots[i];
+        if (!source->used) {
+            continue;
+        }
+        group_entry *target = table_get(into, p, source->bucket, source->group);
+        if (target == NULL) {
+            return -1;
+        }
+        target->rows += source->rows;
+        for (int a = 0; a < p->query->aggregate_count; a++) {
+            accumulator *to = &target->acc[a], *acc = &source->acc[a];
+            to->sum += acc->sum;
+            to->count += acc->count;
+            if (acc->min < to->min) to->min = acc->min;
+            if (acc->max > to->max) to->max = acc->max;
+            if (acc->hist != NULL) {
+                for (uint32_t b = 0; b < p->shapes[a].bins; b++) {
+                    to->hist[b] += acc->hist[b];
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+/* ===== Scan ===== */
+
+typedef struct {
+    plan *plan;
+    group_table table;
+    size_t blocks_scanned, blocks_skipped;
+    uint64_t rows_scanned, rows_matched;
+    int failed;
+} worker;
+
+static int64_t floor_div(int64_t value, int64_t width) {
+    int64_t q = value / width;
+    return (value % width != 0 && (value < 0) != (width < 0)) ? q - 1 : q;
+}
+
+/* True when no row of the block can match the filter */
+static int filter_excludes(const tq_filter *f, int32_t min, int32_t max) {
+    if (max == TQ_NULL) {
+        return 1;  /* Only missing values */
+    }
+    switch (f->op) {
+    case TQ_EQ: return f->value < min || f->value > max;
+    case TQ_NE: return min == max && min == f->value;
+    case TQ_LT: return min >= f->value;
+    case TQ_LE: return min > f->value;
+    case TQ_GT: return max <= f->value;
+    case TQ_GE: return max < f->value;
+    }
+    return 0;
+}
+
+#define SELECT_LOOP(condition)                                  \
+    do {                                                        \
+        if (selected == NULL) {                                 \
+            for (uint32_t i = 0; i < rows; i++) {               \
+                int32_t x = values[i];                          \
+                sel[count] = i;                                 \
+                count += (condition);                           \
+            }                                                   \
+        } else {                                                \
+            for (uint32_t k = 0; k < rows; k++) {               \
+                uint32_t i = selected[k];                       \
+                int32_t x = values[i];                          \
+                sel[count] = i;                                 \
+                count += (condition);                           \
+            }                                                   \
+        }                                                       \
+    } while (0)
+
+/*
+ * Narrow a selection vector with one filter. With selected == NULL every
+ * row of the block is a candidate; otherwise the rows listed in selected
+ * (which may alias sel). Returns the number of rows kept.
+ */
+static uint32_t select_rows(const int32_t *values, const tq_filter *f, const uint32_t *selected,
+                            uint32_t rows, uint32_t *sel) {
+    uint32_t count = 0;
+    int32_t v = f->value;
+    switch (f->op) {
+    case TQ_EQ: SELECT_LOOP(x == v); break;
+    case TQ_NE: SELECT_LOOP(x != v && x != TQ_NULL); break;
+    case TQ_LT: SELECT_LOOP(x < v && x != TQ_NULL); break;
+    case TQ_LE: SELECT_LOOP(x <= v && x != TQ_NULL); break;
+    case TQ_GT: SELECT_LOOP(x > v); break;
+    case TQ_GE: SELECT_LOOP(x >= v); break;
+    }
+    return count;
+}
+
+/* Every row of the block goes into the single group: aggregate whole columns with the vector kernels */
+static void scan_whole_block(worker *w, int32_t **columns, uint32_t rows) {
+    const plan *p = w->plan;
+    const tq_query *q = p->query;
+    group_entry *entry = table_get(&w->table, p, 0, 0);
+    if (entry == NULL) {
+        w->failed = 1;
+        return;
+    }
+    entry->rows += rows;
+    w->rows_matched += rows;
+    for (int a = 0; a < q->aggregate_count; a++) {
+        const tq_aggregate *aggregate = &q->aggregates[a];
+        if (aggregate->kind == TQ_COUNT) {
+            continue;
+        }
+        accumulator *acc = &entry->acc[a];
+        tk_summary summary;
+        tk_stats(columns[aggregate->column], rows, &summary);
+        if (summary.count == 0) {
+            continue;
+        }
+        acc->sum += summary.sum;
+        acc->count += summary.count;
+        if (summary.min < acc->min) acc->min = summary.min;
+        if (summary.max > acc->max) acc->max = summary.max;
+        if (acc->hist != NULL) {
+            const histogram_shape *shape = &p->shapes[a];
+            tk_histogram(columns[aggregate->column], rows, shape->low, shape->shift, acc->hist, shape->bins);
+        }
+    }
+}
+
+static void scan_block(worker *w, const tq_block *block, int32_t **columns, uint32_t *sel) {
+    const plan *p = w->plan;
+    const tq_query *q = p->query;
+    tq_filter filters[TQ_MAX_FILTERS + 2];
+    int filter_count = 0;
+
+    /* Block skipping: min/max of every filtered column, then the time range */
+    for (int f = 0; f < q->filter_count; f++) {
+        const tq_filter *filter = &q->filters[f];
+        if (filter_excludes(filter, block->min[filter->column], block->max[filter->column])) {
+            w->blocks_skipped++;
+            return;
+        }
+        filters[filter_count++] = *filter;
+    }
+    int64_t first = block->t0_ms + block->min[TQ_TIME], last = block->t0_ms + block->max[TQ_TIME];
+    if ((q->since_ms && last < q->since_ms) || (q->until_ms && first >= q->until_ms)) {
+        w->blocks_skipped++;
+        return;
+    }
+    /* Rows at the edges of the range are filtered on their block-relative time */
+    if (q->since_ms && q->since_ms > first) {
+        filters[filter_count++] = (tq_filter){ TQ_TIME, TQ_GE, (int32_t)(q->since_ms - block->t0_ms) };
+    }
+    if (q->until_ms && q->until_ms <= last) {
+        filters[filter_count++] = (tq_filter){ TQ_TIME, TQ_LT, (int32_t)(q->until_ms - block->t0_ms) };
+    }
+    w->blocks_scanned++;
+    w->rows_scanned += block->rows;
+
+    uint32_t rows = block->rows;
+    for (int c = 0; c < TQ_COLUMNS; c++) {
+        if (p->needed[c]) {
+            tk_decode_deltas(block->data + (size_t)c * rows, columns[c], rows);
+        }
+    }
+    const uint32_t *selected = NULL;
+    uint32_t count = rows;
+    for (int f = 0; f < filter_count && count > 0; f++) {
+        count = select_rows(columns[filters[f].column], &filters[f], selected, selected ? count : rows, sel);
+        selected = sel;
+    }
+    if (count == rows && q->group_column < 0 && !q->bucket_ms) {
+        scan_whole_block(w, columns, rows);
+        return;
+    }
+    if (selected == NULL) {
+        for (uint32_t i = 0; i < rows; i++) {
+            sel[i] = i;
+        }
+    }
+
+    /* Aggregate; consecutive rows usually fall into the same group */
+    const int32_t *times = columns[TQ_TIME];
+    const int32_t *group_values = q->group_column >= 0 ? columns[q->group_column] : NULL;
+    group_entry *entry = NULL;
+    int64_t bucket = 0;
+    int32_t group = 0;
+    uint64_t matched = 0;
+    for (uint32_t k = 0; k < count; k++) {
+        uint32_t i = sel[k];
+        if (q->bucket_ms) {
+            bucket = floor_div(block->t0_ms + times[i], q->bucket_ms) * q->bucket_ms;
+        }
+        if (group_values != NULL) {
+            if (group_values[i] == TQ_NULL) {
+                continue;
+            }
+            group = (int32_t)(floor_div(group_values[i], q->group_width) * q->group_width);
+        }
+        if (entry == NULL || entry->bucket != bucket || entry->group != group) {
+            entry = table_get(&w->table, p, bucket, group);
+            if (entry == NULL) {
+                w->failed = 1;
+                return;
+            }
+        }
+        entry->rows++;
+        matched++;
+        for (int a = 0; a < q->aggregate_count; a++) {
+            const tq_aggregate *aggregate = &q->aggregates[a];
+            if (aggregate->kind == TQ_COUNT) {
+                continue;
+            }
+            int32_t x = columns[aggregate->column][i];
+            if (x == TQ_NULL) {
+                continue;
+            }
+            accumulator *acc = &entry->acc[a];
+            acc->sum += x;
+            acc->count++;
+            if (x < acc->min) acc->min = x;
+            if (x > acc->max) acc->max = x;
+            if (acc->hist != NULL) {
+                const histogram_shape *shape = &p->shapes[a];
+                uint32_t bin = (uint32_t)(((int64_t)x - shape->low) / shape->width);
+                acc->hist[bin < shape->bins ? bin : shape->bins - 1]++;
+            }
+        }
+    }
+    w->rows_matched += matched;
+}
+
+static void *scan_worker(void *arg) {
+    worker *w = arg;
+    plan *p = w->plan;
+    const tq_file *file = p->file;
+    int32_t *columns[TQ_COLUMNS] = { 0 };
+    uint32_t *sel = malloc((size_t)file->block_rows * sizeof(uint32_t));
+    int ok = sel != NULL && table_init(&w->table, TQ_INITIAL_GROUPS) == 0;
+    for (int c = 0; c < TQ_COLUMNS && ok; c++) {
+        if (p->needed[c]) {
+            columns[c] = malloc((size_t)file->block_rows * sizeof(int32_t));
+            ok = columns[c] != NULL;
+        }
+    }
+    if (!ok) {
+        w->failed = 1;
+    }
+    while (!w->failed) {
+        size_t index = __atomic_fetch_add(&p->next_block, 1, __ATOMIC_RELAXED);
+        if (index >= file->block_count) {
+            break;
+        }
+        scan_block(w, &file->blocks[index], columns, sel);
+    }
+    for (int c = 0; c < TQ_COLUMNS; c++) {
+        free(columns[c]);
+    }
+    free(sel);
+    return NULL;
+}
+
+static int compare_rows(const void *a, const void *b) {
+    const tq_row *x = a, *y = b;
+    if (x->bucket_ms != y->bucket_ms) {
+        return x->bucket_ms < y->bucket_ms ? -1 : 1;
+    }
+    return (x->group > y->group) - (x->group < y->group);
+}
+
+static double percentile_value(const accumulator *acc, const histogram_shape *shape, double percentile) {
+    uint64_t rank = (uint64_t)ceil(percentile / 100.0 * (double)acc->count);
+    if (rank < 1) {
+        rank = 1;
+    }
+    uint64_t seen = 0;
+    for (uint32_t b = 0; b < shape->bins; b++) {
+        seen += acc->hist[b];
+        if (seen >= rank) {
+            /* Lower edge of the bin, clamped to what was actually seen */
+            double value = shape->low + (double)b * shape->width;
+            return value < acc->min ? acc->min : value > acc->max ? acc->max : value;
+        }
+    }
+    return acc->max;
+}
+
+int tq_run(const tq_file *file, const tq_query *query, tq_result *result) {
+    memset(result, 0, sizeof(*result));
+    if (query->filter_count > TQ_MAX_FILTERS || query->aggregate_count > TQ_MAX_AGGREGATES) {
+        return fail("too many filters or aggregates");
+    }
+    if (query->group_column >= 0 && (query->group_column >= TQ_COLUMNS || query->group_width < 1)) {
+        return fail("invalid group column or width");
+    }
+
+    plan p = { .file = file, .query = query };
+    for (int f = 0; f < query->filter_count; f++) {
+        p.needed[query->filters[f].column] = 1;
+    }
+    if (query->group_column >= 0) {
+        p.needed[query->group_column] = 1;
+    }
+    if (query->bucket_ms || query->since_ms || query->until_ms) {
+        p.needed[TQ_TIME] = 1;
+    }
+    for (int a = 0; a < query->aggregate_count; a++) {
+        const tq_aggregate *aggregate = &query->aggregates[a];
+        if (aggregate->kind == TQ_COUNT) {
+            continue;
+        }
+        p.needed[aggregate->column] = 1;
+        if (aggregate->kind == TQ_PERCENTILE) {
+            /* Power-of-two bins aligned to their width over the column's range in this file */
+            int64_t low = file->min[aggregate->column], high = file->max[aggregate->column];
+            if (high == TQ_NULL) {
+                low = high = 0;
+            }
+            unsigned shift = 0;
+            while ((high - floor_div(low, (int64_t)1 << shift) * ((int64_t)1 << shift)) >> shift >= TQ_HIST_BINS) {
+                shift++;
+            }
+            int64_t width = (int64_t)1 << shift;
+            low = floor_div(low, width) * width;
+            p.shapes[a].low = (int32_t)low;
+            p.shapes[a].width = (int32_t)width;
+            p.shapes[a].shift = shift;
+            p.shapes[a].bins = (uint32_t)((high - low) / width + 1);
+        }
+    }
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t threads = query->threads > 0 ? (size_t)query->threads : (size_t)(cpus > 0 ? cpus : 1);
+    if (threads > file->block_count) {
+        threads = file->block_count ? file->block_count : 1;
+    }
+    worker *workers = calloc(threads, sizeof(worker));
+    pthread_t *ids = calloc(threads, sizeof(pthread_t));
+    if (workers == NULL || ids == NULL) {
+        free(workers);
+        free(ids);
+        return fail("out of memory");
+    }
+    size_t started = 0;
+    for (size_t t = 0; t < threads; t++) {
+        workers[t].plan = &p;
+        if (t > 0 && pthread_create(&ids[t], NULL, scan_worker, &workers[t]) != 0) {
+            break;
+        }
+        started++;
+    }
+    scan_worker(&workers[0]);  /* The calling thread scans too */
+    int failed = workers[0].failed;
+    for (size_t t = 1; t < started; t++) {
+        pthread_join(ids[t], NULL);
+        failed |= workers[t].failed;
+    }
+
+    group_table *groups = &workers[0].table;
+    for (size_t t = 0; t < started; t++) {
+        result->blocks_scanned += workers[t].blocks_scanned;
+        result->blocks_skipped += workers[t].blocks_skipped;
+        result->rows_scanned += workers[t].rows_scanned;
+        result->rows_matched += workers[t].rows_matched;
+        if (t > 0 && !failed) {
+            failed = table_merge(groups, &workers[t].table, &p) != 0;
+        }
+    }
+
+    if (!failed) {
+        result->rows = calloc(groups->count ? groups->count : 1, sizeof(tq_row));
+        failed = result->rows == NULL;
+    }
+    for (size_t i = 0; !failed && i < groups->capacity; i++) {
+        const group_entry *entry = &groups->slots[i];
+        if (!entry->used) {
+            continue;
+        }
+        tq_row *row = &result->rows[result->row_count++];
+        row->bucket_ms = entry->bucket;
+        row->group = entry->group;
+        row->rows = entry->rows;
+        for (int a = 0; a < query->aggregate_count; a++) {
+            const tq_aggregate *aggregate = &query->aggregates[a];
+            const accumulator *acc = &entry->acc[a];
+            double value = NAN;
+            if (aggregate->kind == TQ_COUNT) {
+                row->values[a] = (double)entry->rows;
+                continue;
+            }
+            if (acc->count > 0) {
+                switch (aggregate->kind) {
+                case TQ_MIN: value = acc->min; break;
+                case TQ_MAX: value = acc->max; break;
+                case TQ_MEAN: value = (double)acc->sum / (double)acc->count; break;
+                case TQ_SUM: value = (double)acc->sum; break;
+                case TQ_PERCENTILE: value = percentile_value(acc, &p.shapes[a], aggregate->percentile); break;
+                case TQ_COUNT: break;
+                }
+                value = tq_from_stored(aggregate->column, value);
+            }
+            row->values[a] = value;
+        }
+    }
+    for (size_t t = 0; t < started; t++) {
+        if (workers[t].table.slots != NULL) {
+            table_free(&workers[t].table);
+        }
+    }
+    free(workers);
+    free(ids);
+    if (failed) {
+        tq_result_free(result);
+        return fail("out of memory while scanning");
+    }
+    qsort(result->rows, result->row_count, sizeof(tq_row), compare_rows);
+    return 0;
+}
+
+void tq_result_free(tq_result *result) {
+    free(result->rows);
+    result->rows = NULL;
+    result->row_count = 0;
+}
+
+/* ===== Command line ===== */
+
+#ifndef TQ_LIBRARY
+
+static void format_time(int64_t ms, char *buffer, size_t size) {
+    time_t seconds = (time_t)floor_div(ms, 1000);
+    struct tm tm;
+    localtime_r(&seconds, &tm);
+    strftime(buffer, size, "%Y-%m-%d %H:%M:%S", &tm);
+}
+
+static void print_info(const tq_file *file, const char *path) {
+    char first[32] = "-", last[32] = "-";
+    if (file->rows > 0) {
+        format_time(file->first_ms, first, sizeof(first));
+        format_time(file->last_ms, last, sizeof(last));
+    }
+    printf("%s: %zu blocks, %llu rows, %.1f MB\n", path, file->block_count,
+           (unsigned long long)file->rows, file->size / 1e6);
+    printf("%-12s %s .. %s\n", "time", first, last);
+    for (int c = 1; c < TQ_COLUMNS; c++) {
+        if (c == TQ_PROFILE) {
+            continue;
+        }
+        if (file->max[c] == TQ_NULL) {
+            printf("%-12s -\n", tq_column_name(c));
+        } else {
+            printf("%-12s %g .. %g\n", tq_column_name(c), tq_from_stored(c, file->min[c]),
+                   tq_from_stored(c, file->max[c]));
+        }
+    }
+    printf("%-12s", "profiles");
+    for (uint32_t i = 0; i < file->profile_count; i++) {
+        if (file->profiles[i] != NULL) {
+            printf(" %s", file->profiles[i]);
+        }
+    }
+    printf("\n");
+}
+
+static void print_aggregate_name(const tq_aggregate *aggregate) {
+    static const char *names[] = { "count", "min", "max", "mean", "sum", "p" };
+    if (aggregate->kind == TQ_COUNT) {
+        printf("count");
+    } else if (aggregate->kind == TQ_PERCENTILE) {
+        printf("p%g(%s)", aggregate->percentile, tq_column_name(aggregate->column));
+    } else {
+        printf("%s(%s)", names[aggregate->kind], tq_column_name(aggregate->column));
+    }
+}
+
+static void print_result(const tq_file *file, const tq_query *query, const tq_result *result) {
+    if (query->bucket_ms) {
+        printf("bucket\t");
+    }
+    if (query->group_column >= 0) {
+        printf("%s\t", tq_column_name(query->group_column));
+    }
+    for (int a = 0; a < query->aggregate_count; a++) {
+        print_aggregate_name(&query->aggregates[a]);
+        printf(a + 1 < query->aggregate_count ? "\t" : "\n");
+    }
+    for (size_t r = 0; r < result->row_count; r++) {
+        const tq_row *row = &result->rows[r];
+        if (query->bucket_ms) {
+            char bucket[32];
+            format_time(row->bucket_ms, bucket, sizeof(bucket));
+            printf("%s\t", bucket);
+        }
+        if (query->group_column == TQ_PROFILE) {
+            const char *name = (uint32_t)row->group < file->profile_count ? file->profiles[row->group] : NULL;
+            printf("%s\t", name != NULL ? name : "?");
+        } else if (query->group_column >= 0) {
+            printf("%g\t", tq_from_stored(query->group_column, row->group));
+        }
+        for (int a = 0; a < query->aggregate_count; a++) {
+            if (query->aggregates[a].kind == TQ_COUNT) {
+                printf("%llu", (unsigned long long)row->rows);
+            } else if (isnan(row->values[a])) {
+                printf("-");
+            } else {
+                printf("%.6g", row->values[a]);
+            }
+            printf(a + 1 < query->aggregate_count ? "\t" : "\n");
+        }
+    }
+}
+
+static void print_usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-w filter]... [-g column[:width]] [-b seconds] [-a aggregate]...\n", prog);
+    fprintf(stderr, "       [-s seconds | -S start -E end] [-j threads] [-i] [-v] file\n");
+    fprintf(stderr, "  -w filter      Keep rows matching column<op>value (op: = != < <= > >=); repeat to AND,\n");
+    fprintf(stderr, "                 e.g. -w pstate=0 -w temperature>80 -w profile=quiet\n");
+    fprintf(stderr, "  -g column:w    Group by column, in bins of w (its units: °C, W, V, MHz), e.g. frequency:60\n");
+    fprintf(stderr, "  -b seconds     Group by time buckets of this length\n");
+    fprintf(stderr, "  -a aggregate   count, min:col, max:col, mean:col, sum:col or pNN:col (default count)\n");
+    fprintf(stderr, "  -s seconds     Only the last N seconds of the recording\n");
+    fprintf(stderr, "  -S/-E time     Only rows from/before this unix time\n");
+    fprintf(stderr, "  -j threads     Scan threads (default: online CPUs)\n");
+    fprintf(stderr, "  -i             Print a summary of the recording instead of querying\n");
+    fprintf(stderr, "  -v             Print blocks scanned/skipped and the query time to stderr\n");
+    fprintf(stderr, "Columns: gpu temperature power frequency pstate voltage offset profile\n");
+}
+
+int main(int argc, char **argv) {
+    tq_query query;
+    memset(&query, 0, sizeof(query));
+    query.group_column = -1;
+    double last_seconds = 0;
+    int info = 0, verbose = 0;
+    const char *filters[TQ_MAX_FILTERS];
+    int opt;
+
+    while ((opt = getopt(argc, argv, "w:g:b:a:s:S:E:j:ivh")) != -1) {
+        switch (opt) {
+        case 'w':
+            if (query.filter_count == TQ_MAX_FILTERS) {
+                fprintf(stderr, "Error: At most %d filters\n", TQ_MAX_FILTERS);
+                return 1;
+            }
+            filters[query.filter_count++] = optarg;  /* Parsed once the profile dictionary is loaded */
+            break;
+        case 'g':
+            if (tq_parse_group(optarg, &query) != 0) {
+                fprintf(stderr, "Error: %s\n", tq_error());
+                return 1;
+            }
+            break;
+        case 'b':
+            query.bucket_ms = (int64_t)(atof(optarg) * 1000);
+            if (query.bucket_ms <= 0) {
+                fprintf(stderr, "Error: Invalid bucket length '%s'\n", optarg);
+                return 1;
+            }
+            break;
+        case 'a':
+            if (query.aggregate_count == TQ_MAX_AGGREGATES) {
+                fprintf(stderr, "Error: At most %d aggregates\n", TQ_MAX_AGGREGATES);
+                return 1;
+            }
+            if (tq_parse_aggregate(optarg, &query.aggregates[query.aggregate_count++]) != 0) {
+                fprintf(stderr, "Error: %s\n", tq_error());
+                return 1;
+            }
+            break;
+        case 's':
+            last_seconds = atof(optarg);
+            break;
+        case 'S':
+            query.since_ms = (int64_t)(atof(optarg) * 1000);
+            break;
+        case 'E':
+            query.until_ms = (int64_t)(atof(optarg) * 1000);
+            break;
+        case 'j':
+            query.threads = atoi(optarg);
+            break;
+        case 'i':
+            info = 1;
+            break;
+        case 'v':
+            verbose = 1;
+            break;
+        default:
+            print_usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (optind != argc - 1) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    const char *path = argv[optind];
+
+    tq_file file;
+    if (tq_open(&file, path) != 0) {
+        fprintf(stderr, "Error: %s\n", tq_error());
+        return 1;
+    }
+    if (info) {
+        print_info(&file, path);
+        tq_close(&file);
+        return 0;
+    }
+    for (int f = 0; f < query.filter_count; f++) {
+        if (tq_parse_filter(&file, filters[f], &query.filters[f]) != 0) {
+            fprintf(stderr, "Error: %s\n", tq_error());
+            tq_close(&file);
+            return 1;
+        }
+    }
+    if (query.aggregate_count == 0) {
+        query.aggregates[query.aggregate_count++].kind = TQ_COUNT;
+    }
+    if (last_seconds > 0 && file.rows > 0) {
+        query.since_ms = file.last_ms - (int64_t)(last_seconds * 1000);
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    tq_result result;
+    if (tq_run(&file, &query, &result) != 0) {
+        fprintf(stderr, "Error: %s\n", tq_error());
+        tq_close(&file);
+        return 1;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    print_result(&file, &query, &result);
+    if (verbose) {
+        double ms = (end.tv_sec - start.tv_sec) * 1e3 + (end.tv_nsec - start.tv_nsec) / 1e6;
+        fprintf(stderr, "%zu blocks scanned, %zu skipped; %llu rows scanned, %llu matched; %.2f ms\n",
+                result.blocks_scanned, result.blocks_skipped, (unsigned long long)result.rows_scanned,
+                (unsigned long long)result.rows_matched, ms);
+    }
+    tq_result_free(&result);
+    tq_close(&file);
+    return 0;
+}
+
+#endif /* TQ_LIBRARY */
@@ -0,0 +1,120 @@
+/*
+ * Telemetry Query Engine - library interface
+ *
+ * Filter, group-by, time-bucket and aggregate queries over columnar
+ * recordings written by gpu_offset_control_v2 (record_format 'columnar').
+ * The file is memory-mapped; blocks whose min/max index rules out every
+ * filter are skipped without touching their data, and the remaining blocks
+ * are scanned by a pool of threads that merge their groups at the end.
+ *
+ * Build as a library (no main):
+ *   gcc -O2 -DTQ_LIBRARY -c telemetry_query.c telemetry_kernels.c -pthread  (link with -pthread -lm)
+ */
+
+#ifndef TELEMETRY_QUERY_H
+#define TELEMETRY_QUERY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Columns in file order; stored units are integers */
+enum {
+    TQ_TIME,          /* ms since the block's t0 (unix ms) */
+    TQ_GPU,
+    TQ_TEMPERATURE,   /* 1/256 °C */
+    TQ_POWER,         /* mW */
+    TQ_FREQUENCY,     /* MHz */
+    TQ_PSTATE,
+    TQ_VOLTAGE,       /* µV */
+    TQ_OFFSET,        /* MHz */
+    TQ_PROFILE,       /* dictionary id */
+    TQ_COLUMNS
+};
+
+#define TQ_NULL INT32_MIN     /* Missing value; never matches a filter */
+#define TQ_MAX_FILTERS 16
+#define TQ_MAX_AGGREGATES 8
+
+/* One data block; data points into the mapping (TQ_COLUMNS columns of rows deltas) */
+typedef struct {
+    uint32_t rows;
+    int64_t t0_ms;
+    const int32_t *min;
+    const int32_t *max;
+    const int32_t *data;
+} tq_block;
+
+typedef struct {
+    const uint8_t *map;
+    size_t size;
+    uint32_t block_rows;         /* Largest block in the file */
+    tq_block *blocks;
+    size_t block_count;
+    char **profiles;             /* Indexed by dictionary id; NULL for unused ids */
+    uint32_t profile_count;
+    uint64_t rows;
+    int64_t first_ms, last_ms;   /* Time span of all rows */
+    int32_t min[TQ_COLUMNS];     /* Over all blocks; TQ_NULL if a column has no values */
+    int32_t max[TQ_COLUMNS];
+} tq_file;
+
+typedef enum { TQ_EQ, TQ_NE, TQ_LT, TQ_LE, TQ_GT, TQ_GE } tq_op;
+
+typedef struct {
+    int column;
+    tq_op op;
+    int32_t value;   /* Stored units */
+} tq_filter;
+
+typedef enum { TQ_COUNT, TQ_MIN, TQ_MAX, TQ_MEAN, TQ_SUM, TQ_PERCENTILE } tq_aggregate_kind;
+
+typedef struct {
+    tq_aggregate_kind kind;
+    int column;           /* Ignored for TQ_COUNT */
+    double percentile;    /* TQ_PERCENTILE only, 0-100 */
+} tq_aggregate;
+
+typedef struct {
+    tq_filter filters[TQ_MAX_FILTERS];   /* All must match */
+    int filter_count;
+    int64_t since_ms, until_ms;          /* Unix ms, [since, until); 0 = open */
+    int group_column;                    /* -1 = no grouping */
+    int32_t group_width;                 /* Bin width in stored units (1 = exact values) */
+    int64_t bucket_ms;                   /* Time bucket width; 0 = no buckets */
+    tq_aggregate aggregates[TQ_MAX_AGGREGATES];
+    int aggregate_count;
+    int threads;                         /* 0 = one per online CPU */
+} tq_query;
+
+/* One output row; values are in user units (°C, W, V, MHz) */
+typedef struct {
+    int64_t bucket_ms;    /* Start of the time bucket (0 without buckets) */
+    int32_t group;        /* Lower bound of the bin in stored units (0 without grouping) */
+    uint64_t rows;
+    double values[TQ_MAX_AGGREGATES];   /* NAN where no row had a value */
+} tq_row;
+
+typedef struct {
+    tq_row *rows;         /* Sorted by bucket, then group */
+    size_t row_count;
+    size_t blocks_scanned, blocks_skipped;
+    uint64_t rows_scanned, rows_matched;
+} tq_result;
+
+/* All functions returning int return 0 on success, -1 with tq_error() set on failure */
+int tq_open(tq_file *file, const char *path);
+void tq_close(tq_file *file);
+int tq_run(const tq_file *file, const tq_query *query, tq_result *result);
+void tq_result_free(tq_result *result);
+const char *tq_error(void);
+
+/* Helpers for building queries from text */
+int tq_column(const char *name);                          /* -1 if unknown */
+const char *tq_column_name(int column);
+int32_t tq_to_stored(int column, double value);
+double tq_from_stored(int column, double value);
+int tq_parse_filter(const tq_file *file, const char *expr, tq_filter *filter);      /* "temperature>80" */
+int tq_parse_aggregate(const char *spec, tq_aggregate *aggregate);                  /* "p99:temperature" */
+int tq_parse_group(const char *spec, tq_query *query);                             /* "frequency:60" */
+
+#endif /* TELEMETRY_QUERY_H */
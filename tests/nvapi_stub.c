@@ -0,0 +1,66 @@
+/*
+ * Stub libnvidia-api.so.1 for testing nvidia_stats without an NVIDIA GPU
+ *
+ * Reports two GPUs with slowly changing hotspot/VRAM temperatures and core
+ * voltage. Set NVAPI_STUB_NO_VOLTAGE=1 to hide the voltage call, as on
+ * drivers that do not export it.
+ *
+ * Compile: gcc -O2 -shared -fPIC -o libnvidia-api.so.1 nvapi_stub.c
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+
+typedef int32_t NvAPI_Status;
+
+typedef struct {
+    uint32_t version;
+    int32_t mask;
+    int32_t values[40];
+} NvApiThermals;
+
+typedef struct {
+    uint32_t version;
+    uint32_t flags;
+    uint32_t padding_1[8];
+    uint32_t value_uv;
+    uint32_t padding_2[8];
+} NvApiVoltage;
+
+static uint32_t calls = 0;
+
+static NvAPI_Status stub_initialize(void) { return 0; }
+static NvAPI_Status stub_unload(void) { return 0; }
+
+static NvAPI_Status stub_enum_physical_gpus(void *handles[], uint32_t *count) {
+    handles[0] = (void *)1;
+    handles[1] = (void *)2;
+    *count = 2;
+    return 0;
+}
+
+static NvAPI_Status stub_get_thermals(void *handle, NvApiThermals *thermals) {
+    (void)handle;
+    if ((uint32_t)thermals->mask > 0xff) return -1;   /* Sensors 0-7 */
+    calls++;
+    thermals->values[9] = (int32_t)(60 + calls / 50 % 3) * 256;
+    thermals->values[15] = (int32_t)(70 + calls / 200 % 2) * 256;
+    return 0;
+}
+
+static NvAPI_Status stub_get_voltage(void *handle, NvApiVoltage *voltage) {
+    (void)handle;
+    voltage->value_uv = 700000 + calls / 100 % 2 * 50000;
+    return 0;
+}
+
+void *nvapi_QueryInterface(uint32_t id) {
+    switch (id) {
+    case 0x0150e828: return (void *)stub_initialize;
+    case 0xd22bdd7e: return (void *)stub_unload;
+    case 0xe5ac921f: return (void *)stub_enum_physical_gpus;
+    case 0x65fe3aad: return (void *)stub_get_thermals;
+    case 0x465f9bcf: return getenv("NVAPI_STUB_NO_VOLTAGE") ? NULL : (void *)stub_get_voltage;
+    default:         return NULL;
+    }
+}
@@ -0,0 +1,62 @@
+#!/bin/bash
+#
+# Checks that nvidia_stats sampling mode does no heap allocation per tick:
+# runs it against the stub NVAPI library under the malloc counter for a
+# short and a long run and requires the same allocation count for both.
+# Also checks that stdout carries only sample lines and that a driver
+# without the voltage call still samples.
+#
+# Run: tests/nvidia_stats_alloc_test.sh   (from anywhere; needs gcc)
+
+set -eu
+
+here=$(cd "$(dirname "$0")" && pwd)
+build=$(mktemp -d)
+trap 'rm -rf "$build"' EXIT
+
+gcc -O2 -Wall -o "$build/nvidia_stats" "$here/../nvidia_stats.c" -ldl
+gcc -O2 -Wall -shared -fPIC -o "$build/libnvidia-api.so.1" "$here/nvapi_stub.c"
+gcc -O2 -Wall -shared -fPIC -o "$build/malloc_counter.so" "$here/malloc_counter.c"
+
+failed=0
+
+fail() {
+    echo "FAIL: $*"
+    failed=1
+}
+
+# Prints the allocation count of one sampling run of $1 ticks
+allocations() {
+    LD_LIBRARY_PATH="$build" LD_PRELOAD="$build/malloc_counter.so" \
+        "$build/nvidia_stats" -i 1 -n "$1" 2>&1 >/dev/null | sed -n 's/^allocations=//p'
+}
+
+short=$(allocations 10)
+long=$(allocations 500)
+echo "allocations: 10 ticks=$short, 500 ticks=$long"
+if [ -z "$short" ] || [ "$short" != "$long" ]; then
+    fail "allocation count grows with the number of ticks"
+fi
+
+# Sampling output is key=value lines only
+output=$(LD_LIBRARY_PATH="$build" "$build/nvidia_stats" -i 1 -n 3 2>/dev/null)
+if [ "$(echo "$output" | grep -vc '^t=')" != 0 ] || [ "$(echo "$output" | wc -l)" != 6 ]; then
+    fail "sampling stdout is not exactly one sample line per GPU per tick"
+fi
+
+# Without the voltage call: voltage reads 0, thermals still sampled
+if ! output=$(NVAPI_STUB_NO_VOLTAGE=1 LD_LIBRARY_PATH="$build" "$build/nvidia_stats" -i 1 -n 2 2>/dev/null); then
+    fail "sampling exits with an error when the voltage call is missing"
+elif ! echo "$output" | grep -q 'voltage_uv=0 hotspot=60 vram=70 status=0'; then
+    fail "unexpected samples without the voltage call: $output"
+fi
+if ! output=$(NVAPI_STUB_NO_VOLTAGE=1 LD_LIBRARY_PATH="$build" "$build/nvidia_stats" 2>/dev/null); then
+    fail "one-shot report exits with an error when the voltage call is missing"
+elif ! echo "$output" | grep -q 'Core Voltage: Not available'; then
+    fail "one-shot report does not mark the voltage as not available"
+fi
+
+if [ "$failed" = 0 ]; then
+    echo "PASS"
+fi
+exit "$failed"
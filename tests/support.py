@@ -0,0 +1,45 @@
+"""
+Loads gpu_offset_control_v2 as a module for the tests.
+
+When nvidia-ml-py is not installed, pynvml is replaced by a stub with
+NVMLError and the constants the script reads; the tests only drive the
+simulated device (install_simulated_nvml) and parts that never call NVML.
+"""
+
+import importlib.machinery
+import importlib.util
+import os
+import sys
+import types
+
+SCRIPT = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'gpu_offset_control_v2')
+
+try:
+    import pynvml  # noqa: F401
+except ImportError:
+    pynvml = types.ModuleType('pynvml')
+
+    class NVMLError(Exception):
+        pass
+
+    pynvml.NVMLError = NVMLError
+    pynvml.NVML_TEMPERATURE_GPU = 0
+    pynvml.NVML_CLOCK_GRAPHICS = 0
+    pynvml.nvmlClockOffset_v1 = 0x1000010
+    sys.modules['pynvml'] = pynvml
+
+loader = importlib.machinery.SourceFileLoader('gpu_offset_control', SCRIPT)
+control = importlib.util.module_from_spec(importlib.util.spec_from_loader(loader.name, loader))
+loader.exec_module(control)
+
+
+def simulated_controller(config=None, clock=None):
+    """GpuController of simulated GPU 0 with CONFIG (plus overrides) bound as params and profiles."""
+    config = dict(control.CONFIG, show_info=False, **(config or {}))
+    if clock is None:
+        control.install_simulated_nvml(1)
+    else:
+        control.install_simulated_nvml(1, clock)
+    params = control.ControlParams(config)
+    profiles = control.build_profiles(config, params)
+    return control.GpuController(control.nvmlDeviceGetHandleByIndex(0), 0, params, 0, profiles)
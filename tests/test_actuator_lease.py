@@ -0,0 +1,76 @@
+#!/usr/bin/env python3
+"""
+Checks for the actuator lease and the read-back conflict monitor of
+gpu_offset_control_v2.
+
+Run: python3 tests/test_actuator_lease.py
+"""
+
+import os
+import tempfile
+import unittest
+
+from support import control, simulated_controller
+
+
+class ActuatorLeaseTest(unittest.TestCase):
+    def test_acquire_and_release(self):
+        with tempfile.TemporaryDirectory() as directory:
+            path = os.path.join(directory, 'gpu0.lease')
+            lease = control.ActuatorLease(path, 50, 3)
+            self.assertTrue(lease.update(0.0))
+            with open(path) as f:
+                self.assertIn(f"pid={os.getpid()} priority=50", f.read())
+            lease.release()
+            with open(path) as f:
+                self.assertEqual(f.read(), '')
+
+    def test_unusable_path_disables_lease(self):
+        # The lease cannot be created (e.g. /run not writable): the controller
+        # must keep running as the only writer, on every later renewal too
+        lease = control.ActuatorLease('/dev/null/gpu0.lease', 50, 3)
+        self.assertTrue(lease.update(0.0))
+        self.assertIsNone(lease.path)
+        for now in (0.5, 1.0, 10.0, 1000.0):
+            self.assertTrue(lease.update(now))
+        lease.release()
+
+
+class ConflictMonitorTest(unittest.TestCase):
+    def setUp(self):
+        # Virtual time in the simulator's full-load phase: P0, the offset target moves
+        self.time = [30.0]
+        self.controller = simulated_controller(clock=lambda: self.time[0])
+        self.controller.conflicts = control.ConflictMonitor(1, 300)
+        self.gpu = self.controller.handle
+
+    def run_ticks(self, count):
+        for _ in range(count):
+            self.controller.tick()
+            self.controller.checkpoint(self.time[0])
+            self.time[0] += 1.0
+
+    def test_rejected_writes_are_not_conflicts(self):
+        self.assertTrue(control.apply_clock_offset(self.gpu, 150, 0))
+        self.controller.last_applied_offset = 150
+
+        def reject(handle, info):
+            raise control.NVMLError("insufficient permissions")
+        control.nvmlDeviceSetClockOffsets = reject
+        self.run_ticks(10)
+        self.assertEqual(self.controller.conflicts.conflicts, 0)
+        self.assertEqual(self.controller.last_applied_offset, 150)
+        self.assertFalse(self.controller.conflicts.blocked(self.time[0]))
+
+    def test_external_write_is_a_conflict(self):
+        self.run_ticks(3)
+        applied = self.controller.last_applied_offset
+        self.assertEqual(self.gpu.offsets[0], applied)
+        self.gpu.offsets[0] = applied + 90  # e.g. nvidia-smi or a shell script
+        self.run_ticks(2)
+        self.assertEqual(self.controller.conflicts.conflicts, 1)
+        self.assertEqual(self.controller.last_applied_offset, applied + 90)
+
+
+if __name__ == '__main__':
+    unittest.main()
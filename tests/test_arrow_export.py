@@ -0,0 +1,95 @@
+#!/usr/bin/env python3
+"""
+Checks the Arrow output of gpu_offset_control_v2: --export-arrow of a
+columnar recording, and record_format 'arrow'. Skipped without pyarrow.
+
+Run: python3 tests/test_arrow_export.py
+"""
+
+import os
+import tempfile
+import types
+import unittest
+from unittest import mock
+
+from support import control
+
+try:
+    import pyarrow as pa
+    import pyarrow.ipc  # noqa: F401
+except ImportError:
+    pa = None
+
+PARAMS = types.SimpleNamespace(record_block_rows=64, record_flush_interval=3600)
+T0 = 1700000000.0
+ROWS = 200
+
+
+def rows():
+    """(time, gpu, stats, offset, profile) rows; voltage and offset are missing at first."""
+    for i in range(ROWS):
+        stats = types.SimpleNamespace(temperature=40 + i % 40 + 0.5, power=20.0 + i, frequency=210 + 7 * i,
+                                      pstate=0 if i % 3 else 8, voltage_value=None if i < 10 else 0.75 + i / 1000)
+        yield T0 + i, i % 2, stats, None if i < 5 else i - 100, 'battery' if 100 <= i < 150 else 'default'
+
+
+def record(recorder):
+    now = [T0]
+    with mock.patch.object(control.time, 'time', lambda: now[0]):
+        for now[0], gpu, stats, offset, profile in rows():
+            recorder.record(gpu, stats, offset, profile)
+        recorder.close()
+
+
+@unittest.skipIf(pa is None, "pyarrow is not installed")
+class ArrowExportTest(unittest.TestCase):
+    def setUp(self):
+        self.directory = tempfile.TemporaryDirectory()
+
+    def tearDown(self):
+        self.directory.cleanup()
+
+    def path(self, name):
+        return os.path.join(self.directory.name, name)
+
+    def check(self, table):
+        self.assertEqual(table.schema, control.arrow_schema(pa))
+        self.assertEqual(table.num_rows, ROWS)
+        columns = table.to_pydict()
+        for i, (now, gpu, stats, offset, profile) in enumerate(rows()):
+            self.assertEqual(columns['time'][i].timestamp(), now)
+            self.assertEqual(columns['gpu'][i], gpu)
+            self.assertEqual(columns['temperature'][i], stats.temperature)
+            self.assertAlmostEqual(columns['power'][i], stats.power, places=3)
+            self.assertEqual(columns['frequency'][i], stats.frequency)
+            self.assertEqual(columns['pstate'][i], f'P{stats.pstate}')
+            if stats.voltage_value is None:
+                self.assertIsNone(columns['voltage'][i])
+            else:
+                self.assertAlmostEqual(columns['voltage'][i], stats.voltage_value, places=5)
+            self.assertEqual(columns['offset'][i], offset)
+            self.assertEqual(columns['profile'][i], profile)
+
+    def test_export_file(self):
+        record(control.ColumnarRecorder(self.path('gpu.gtr'), PARAMS))
+        exported, batches = control.export_arrow(self.path('gpu.gtr'), self.path('gpu.arrow'), 100)
+        self.assertEqual(exported, ROWS)
+        self.assertGreater(batches, 1)
+        with pa.memory_map(self.path('gpu.arrow')) as source:
+            self.check(pa.ipc.open_file(source).read_all())
+
+    def test_export_stream(self):
+        record(control.ColumnarRecorder(self.path('gpu.gtr'), PARAMS))
+        control.export_arrow(self.path('gpu.gtr'), self.path('gpu.arrows'), 100)
+        with pa.memory_map(self.path('gpu.arrows')) as source:
+            self.check(pa.ipc.open_stream(source).read_all())
+
+    def test_arrow_recorder(self):
+        # 'battery' is first seen mid-run and reaches the reader as a dictionary replacement
+        record(control.ArrowRecorder(self.path('gpu.arrows'), PARAMS, ['default']))
+        with pa.memory_map(self.path('gpu.arrows')) as source:
+            self.check(pa.ipc.open_stream(source).read_all())
+
+
+if __name__ == '__main__':
+    unittest.main()
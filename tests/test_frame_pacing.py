@@ -0,0 +1,72 @@
+#!/usr/bin/env python3
+"""
+Checks the frame-pacing offset damping of gpu_offset_control_v2 and the
+frame-time log follower.
+
+Run: python3 tests/test_frame_pacing.py
+"""
+
+import os
+import tempfile
+import types
+import unittest
+from unittest import mock
+
+from support import control
+
+PARAMS = types.SimpleNamespace(frametime_window=5, frametime_hold_band=30, frametime_min_dwell=10,
+                               frametime_min_frames=100)
+
+
+class SteadyFrames:
+    """Frame-time source that delivers 60 frames of 7 ms per poll."""
+
+    def poll(self, now, out):
+        out.extend([7.0] * 60)
+
+
+class FramePacingTest(unittest.TestCase):
+    def setUp(self):
+        self.pacing = control.FramePacing(SteadyFrames())
+        self.pacing.update(150, PARAMS, 100.0)  # Offset 150 in effect since t=100
+
+    def choose(self, target, now):
+        self.pacing.update(150, PARAMS, now)
+        return self.pacing.choose(target, 150, PARAMS, now)
+
+    def test_small_increase_is_held(self):
+        self.assertEqual(self.choose(165, 120.0), 150)
+        self.assertEqual(self.pacing.held, 1)
+
+    def test_increase_waits_for_dwell(self):
+        self.assertEqual(self.choose(210, 105.0), 150)
+        self.assertEqual(self.choose(210, 110.0), 210)
+
+    def test_decreases_apply_at_once(self):
+        # Drain steps near the critical temperature are smaller than the band
+        # and come right after the last change; neither may hold them back
+        self.assertEqual(self.choose(135, 100.5), 135)
+        self.assertEqual(self.choose(60, 100.5), 60)
+        self.assertEqual(self.pacing.held, 0)
+
+    def test_no_frames_no_damping(self):
+        self.assertEqual(self.pacing.choose(165, 150, PARAMS, 200.0), 165)
+
+
+class FrameTimeSourceTest(unittest.TestCase):
+    def test_log_rotated_between_glob_and_stat(self):
+        with tempfile.TemporaryDirectory() as directory:
+            log = os.path.join(directory, 'game_2024-01-02.csv')
+            with open(log, 'w') as f:
+                f.write('fps,frametime\n')
+            rotated = os.path.join(directory, 'game_2024-01-01.csv')
+            source = control.FrameTimeSource('', os.path.join(directory, '*.csv'))
+            with mock.patch.object(control.glob, 'glob', return_value=[rotated, log]):
+                source.follow_newest()
+            self.assertEqual(source.log_path, log)
+            self.assertEqual(source.column, 1)
+            source.close()
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,86 @@
+#!/usr/bin/env python3
+"""
+Checks the host power and temperature monitor of gpu_offset_control_v2 on a
+fake sysfs tree.
+
+Run: python3 tests/test_host_monitor.py
+"""
+
+import os
+import tempfile
+import unittest
+
+from support import control
+
+
+class HostMonitorTest(unittest.TestCase):
+    def setUp(self):
+        self.directory = tempfile.TemporaryDirectory()
+        self.root = self.directory.name
+        self.write('class/powercap/intel-rapl:0/name', 'package-0')
+        self.write('class/powercap/intel-rapl:0/energy_uj', '1000000')
+        self.write('class/powercap/intel-rapl:0/max_energy_range_uj', '262143328850')
+        self.write('class/powercap/intel-rapl:0:0/name', 'core')  # Sub-zone, inside the package
+        self.write('class/powercap/intel-rapl:0:0/energy_uj', '500000')
+        self.write('class/powercap/intel-rapl:1/name', 'psys')  # Covers the GPU too
+        self.write('class/powercap/intel-rapl:1/energy_uj', '9000000')
+        self.write('class/hwmon/hwmon0/name', 'coretemp')
+        self.write('class/hwmon/hwmon0/temp1_input', '61000')
+        self.write('class/hwmon/hwmon0/temp2_input', '74000')
+        self.write('class/hwmon/hwmon1/name', 'nvme')
+        self.write('class/hwmon/hwmon1/temp1_input', '90000')
+        self.monitor = None
+
+    def tearDown(self):
+        if self.monitor is not None:
+            self.monitor.close()
+        self.directory.cleanup()
+
+    def write(self, relative, value):
+        path = os.path.join(self.root, relative)
+        os.makedirs(os.path.dirname(path), exist_ok=True)
+        with open(path, 'w') as f:
+            f.write(value + '\n')
+
+    def start(self):
+        self.monitor = control.HostMonitor(self.root, ['coretemp', 'k10temp'])
+        return self.monitor
+
+    def test_reads_package_power_and_hottest_sensor(self):
+        monitor = self.start()
+        self.assertEqual(len(monitor.zones), 1)
+        self.assertEqual(len(monitor.temp_fds), 2)
+        monitor.update(100.0)
+        self.write('class/powercap/intel-rapl:0/energy_uj', '31000000')  # 30 J in 2 s
+        monitor.update(102.0)
+        self.assertAlmostEqual(monitor.cpu_power, 15.0)
+        self.assertEqual(monitor.temperature, 74.0)
+
+    def test_counter_wrap(self):
+        self.write('class/powercap/intel-rapl:0/max_energy_range_uj', '4000000')
+        self.write('class/powercap/intel-rapl:0/energy_uj', '3000000')
+        monitor = self.start()
+        monitor.update(0.0)
+        self.write('class/powercap/intel-rapl:0/energy_uj', '1000000')  # Wrapped: 2 J in 1 s
+        monitor.update(1.0)
+        self.assertAlmostEqual(monitor.cpu_power, 2.0)
+
+    def test_unreadable_name_skips_the_sensor(self):
+        # A zone and an hwmon device whose name cannot be read (here: a directory)
+        os.mkdir(os.path.join(self.root, 'class/powercap/intel-rapl:2'))
+        os.mkdir(os.path.join(self.root, 'class/powercap/intel-rapl:2/name'))
+        self.write('class/powercap/intel-rapl:2/energy_uj', '0')
+        os.mkdir(os.path.join(self.root, 'class/hwmon/hwmon2'))
+        os.mkdir(os.path.join(self.root, 'class/hwmon/hwmon2/name'))
+        monitor = self.start()
+        self.assertEqual(len(monitor.zones), 1)
+        self.assertEqual(len(monitor.temp_fds), 2)
+
+    def test_no_sensors(self):
+        with tempfile.TemporaryDirectory() as empty:
+            with self.assertRaises(OSError):
+                control.HostMonitor(empty, ['coretemp'])
+
+
+if __name__ == '__main__':
+    unittest.main()
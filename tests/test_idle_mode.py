@@ -0,0 +1,82 @@
+#!/usr/bin/env python3
+"""
+Checks active idle mode of gpu_offset_control_v2 on the simulated load
+pattern (idle, then full load).
+
+Run: python3 tests/test_idle_mode.py
+"""
+
+import contextlib
+import io
+import os
+import tempfile
+import time
+import unittest
+from unittest import mock
+
+from support import control, simulated_controller
+
+IDLE_MEMORY_CLOCK = 405
+
+
+class IdleModeTest(unittest.TestCase):
+    def setUp(self):
+        self.directory = tempfile.TemporaryDirectory()
+        self.time = [0.0]  # One virtual clock for the simulator and the controller
+        self.controller = simulated_controller({'idle_dwell': 5, 'idle_memory_clock': IDLE_MEMORY_CLOCK},
+                                               lambda: self.time[0])
+        self.gpu = self.controller.handle
+
+    def tearDown(self):
+        self.directory.cleanup()
+
+    def run_until(self, end):
+        with mock.patch.object(control.time, 'monotonic', lambda: self.time[0]), \
+                contextlib.redirect_stdout(io.StringIO()):
+            while self.time[0] < end:
+                self.controller.tick()
+                self.controller.checkpoint(self.time[0])
+                self.time[0] += 1.0
+
+    def start(self):
+        self.controller.idle = control.IdleMode(self.controller)
+        return self.controller.idle
+
+    def test_enters_after_dwell_and_leaves_on_load(self):
+        idle = self.start()
+        self.run_until(4)
+        self.assertFalse(idle.active)
+        self.run_until(10)
+        self.assertTrue(idle.active)
+        self.assertEqual(self.gpu.memory_clock, IDLE_MEMORY_CLOCK)
+        self.assertEqual(self.controller.selector.selected, 'idle')
+        self.assertEqual(self.controller.params.max_clock, self.controller.profiles['idle'].max_clock)
+        self.run_until(22)  # Full load from 20 s
+        self.assertFalse(idle.active)
+        self.assertEqual(self.gpu.memory_clock, self.gpu.MEMORY_CLOCK_MAX)
+        self.assertEqual(self.controller.selector.selected, 'default')
+        self.assertEqual(idle.entries, 1)
+
+    def test_stale_lock_is_reset_only_through_the_lease(self):
+        self.gpu.memory_clock = IDLE_MEMORY_CLOCK  # Left behind by a run that died idle
+        path = os.path.join(self.directory.name, 'gpu0.lease')
+        with open(path, 'w') as f:  # Held by another live writer with a higher priority
+            f.write(f"pid={os.getppid()} priority=90 owner=other heartbeat={time.time():.3f}\n")
+        self.controller.lease = control.ActuatorLease(path, 50, 60)
+        idle = self.start()
+        self.run_until(3)
+        self.assertEqual(self.gpu.memory_clock, IDLE_MEMORY_CLOCK)
+        self.assertEqual(self.controller.lease.refused_writes, 0)
+        open(path, 'w').close()  # The other writer is done
+        self.run_until(5)
+        self.assertTrue(self.controller.lease.held)
+        self.assertEqual(self.gpu.memory_clock, self.gpu.MEMORY_CLOCK_MAX)
+        self.assertFalse(idle.stale_lock)
+
+    def test_slots(self):
+        with self.assertRaises(AttributeError):
+            self.start().idle = True
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,82 @@
+#!/usr/bin/env python3
+"""
+Checks the input pre-boost of gpu_offset_control_v2: a FIFO stands in for
+the input device, the simulated GPU for the card.
+
+Run: python3 tests/test_input_boost.py
+"""
+
+import contextlib
+import io
+import os
+import selectors
+import tempfile
+import unittest
+
+from support import control, simulated_controller
+
+BOOST_MIN_CLOCK = 1200
+
+
+class InputBoostTest(unittest.TestCase):
+    def setUp(self):
+        self.directory = tempfile.TemporaryDirectory()
+        self.fifo = os.path.join(self.directory.name, 'boost.fifo')
+        os.mkfifo(self.fifo)
+        self.events = selectors.DefaultSelector()
+        self.time = [5.0]  # Idle phase of the simulated load pattern: P8
+        self.controller = simulated_controller({'boost_min_clock': BOOST_MIN_CLOCK, 'boost_duration': 2},
+                                               lambda: self.time[0])
+        self.gpu = self.controller.handle
+        self.boost = control.InputBoost([self.fifo], self.controller, self.events)
+        self.controller.boost = self.boost
+        with contextlib.redirect_stdout(io.StringIO()):
+            self.controller.apply_initial_settings()
+            self.controller.tick()
+
+    def tearDown(self):
+        self.boost.close()
+        self.events.close()
+        self.directory.cleanup()
+
+    def press_key(self):
+        """Write to the FIFO and dispatch the selector events, as the main loop does."""
+        fd = os.open(self.fifo, os.O_WRONLY | os.O_NONBLOCK)
+        os.write(fd, b'\n')
+        os.close(fd)
+        for key, _ in self.events.select(timeout=1.0):
+            key.data(key.fileobj)
+
+    def test_input_while_idle_raises_floor_and_applies_offset(self):
+        self.assertEqual(self.controller.stats.pstate, 8)
+        self.assertEqual(self.gpu.offsets.get(0, 0), 0)
+        self.press_key()
+        self.assertTrue(self.boost.active)
+        self.assertEqual(self.boost.boosts, 1)
+        self.assertEqual(self.gpu.locked_min, BOOST_MIN_CLOCK)
+        self.assertEqual(self.controller.applied_clocks[0], BOOST_MIN_CLOCK)
+        self.assertGreater(self.gpu.offsets[0], 0)
+        self.assertGreaterEqual(self.gpu.graphics_clock(), BOOST_MIN_CLOCK)  # The floor applies at once
+
+    def test_boost_lapses_after_the_last_input(self):
+        self.press_key()
+        last_input = self.boost.last_input
+        self.boost.expire(last_input + 1.0)
+        self.assertTrue(self.boost.active)
+        self.boost.expire(last_input + 2.0)
+        self.assertFalse(self.boost.active)
+        self.assertEqual(self.gpu.locked_min, self.controller.params.min_clock)
+
+    def test_no_boost_while_busy(self):
+        self.time[0] = 30.0  # Full load: P0
+        with contextlib.redirect_stdout(io.StringIO()):
+            self.controller.tick()
+        self.assertEqual(self.controller.stats.pstate, 0)
+        self.press_key()
+        self.assertFalse(self.boost.active)
+        self.assertEqual(self.boost.boosts, 0)
+        self.assertEqual(self.gpu.locked_min, self.controller.params.min_clock)
+
+
+if __name__ == '__main__':
+    unittest.main()
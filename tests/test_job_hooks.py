@@ -0,0 +1,49 @@
+#!/usr/bin/env python3
+"""
+Checks the job hook requests of gpu_offset_control_v2.
+
+Run: python3 tests/test_job_hooks.py
+"""
+
+import os
+import selectors
+import stat
+import tempfile
+import unittest
+from unittest import mock
+
+from support import control, simulated_controller
+
+
+class JobHooksTest(unittest.TestCase):
+    def setUp(self):
+        self.directory = tempfile.TemporaryDirectory()
+        self.events = selectors.DefaultSelector()
+        self.controller = simulated_controller({'profiles': {'quiet': {'max_clock': 1500}}})
+        self.path = os.path.join(self.directory.name, 'gpu0.sock')
+        self.hooks = control.JobHooks(self.path, 0o660, self.controller, '', self.events)
+
+    def tearDown(self):
+        self.hooks.close()
+        self.events.close()
+        self.directory.cleanup()
+
+    def test_socket_mode(self):
+        self.assertEqual(stat.S_IMODE(os.stat(self.path).st_mode), 0o660)
+
+    def test_start_and_end(self):
+        self.assertEqual(self.hooks.handle('start job=7 profile=quiet'), 'ok job=7 profile=quiet')
+        self.assertEqual(self.controller.params.max_clock, 1500)
+        self.assertTrue(self.hooks.handle('end job=7').startswith('ok job=7 seconds='))
+        self.assertEqual(self.controller.selector.selected, 'default')
+
+    def test_nvml_error_is_answered(self):
+        lost = control.NVMLError("GPU is lost")
+        with mock.patch.object(control.GpuController, 'prepare_for_load', side_effect=lost):
+            reply = self.hooks.handle('start job=7')
+        self.assertTrue(reply.startswith('error job 7 started'), reply)
+        self.assertTrue(self.hooks.handle('end job=7').startswith('ok job=7'))
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,63 @@
+#!/usr/bin/env python3
+"""
+Checks that only the default profile's settings become last-known-good.
+
+Run: python3 tests/test_last_known_good.py
+"""
+
+import os
+import tempfile
+import unittest
+
+from support import control, simulated_controller
+
+# Profiles held by other sources for longer than the confirm time
+PROFILES = {
+    'battery': {'max_clock': 1200, 'power_offset_max': 60},
+    'idle': {'max_clock': 900, 'freq_offset_min': 0, 'memory_offset': 0},
+}
+
+
+class LastKnownGoodTest(unittest.TestCase):
+    def setUp(self):
+        self.directory = tempfile.TemporaryDirectory()
+        self.path = os.path.join(self.directory.name, 'gpu0.lkg')
+        self.controller = simulated_controller({'profiles': PROFILES})
+        self.controller.lkg = control.LastKnownGood(self.path, 0, 10)
+        self.controller.apply_initial_settings()
+
+    def tearDown(self):
+        self.directory.cleanup()
+
+    def hold(self, source, profile, start, end):
+        """Hold a profile from start to end (seconds), checkpointing once a second."""
+        self.controller.selector.request(source, profile)
+        self.controller.apply_selected_profile()
+        for now in range(start, end):
+            self.controller.lkg.update(self.controller, float(now))
+
+    def saved(self):
+        return control.read_settings_line(self.path)
+
+    def test_default_settings_are_saved(self):
+        self.hold('power', None, 0, 12)
+        default = self.controller.profiles['default']
+        self.assertEqual(self.saved(), {'gpu': 0, 'offset': control.stable_offset(default),
+                                        'locked_min': default.min_clock, 'locked_max': default.max_clock})
+
+    def test_held_profiles_do_not_replace_saved_settings(self):
+        self.hold('power', None, 0, 12)
+        saved = self.saved()
+        for source, profile in (('power', 'battery'), ('idle', 'idle')):
+            self.hold(source, profile, 12, 200)
+            self.assertEqual(self.saved(), saved, f"'{profile}' became last-known-good")
+            self.hold(source, None, 200, 212)
+        self.assertEqual(self.saved(), saved)
+
+    def test_held_profile_is_never_saved(self):
+        self.hold('idle', 'idle', 0, 200)
+        self.assertFalse(os.path.exists(self.path))
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,76 @@
+#!/usr/bin/env python3
+"""
+Checks the AC/battery monitor of gpu_offset_control_v2 on a fake
+power_supply directory.
+
+Run: python3 tests/test_power_supply.py
+"""
+
+import errno
+import os
+import selectors
+import tempfile
+import unittest
+
+from support import control, simulated_controller
+
+
+class FailingSocket:
+    """Stands in for the uevent socket: recv raises the given errors, then would block."""
+
+    def __init__(self, *errors):
+        self.errors = list(errors)
+        self.calls = 0
+
+    def recv(self, size):
+        self.calls += 1
+        if self.calls > 10:
+            raise AssertionError("read() keeps retrying a failing socket")
+        if self.errors:
+            raise self.errors.pop(0)
+        raise BlockingIOError()
+
+
+class PowerSupplyMonitorTest(unittest.TestCase):
+    def setUp(self):
+        self.directory = tempfile.TemporaryDirectory()
+        for name, supply_type in (('AC', 'Mains'), ('BAT0', 'Battery')):
+            os.mkdir(os.path.join(self.directory.name, name))
+            self.write(name, 'type', supply_type)
+            self.write(name, 'online', '1')
+        self.events = selectors.DefaultSelector()
+        self.controller = simulated_controller({'profiles': {'battery': {'max_clock': 1200}}})
+        try:
+            self.monitor = control.PowerSupplyMonitor(self.directory.name, self.controller, 'battery', self.events)
+        except OSError as e:
+            self.skipTest(f"no uevent socket: {e}")
+        self.monitor.refresh()
+
+    def tearDown(self):
+        if hasattr(self, 'monitor'):
+            self.monitor.close()
+        self.events.close()
+        self.directory.cleanup()
+
+    def write(self, supply, attribute, value):
+        with open(os.path.join(self.directory.name, supply, attribute), 'w') as f:
+            f.write(value + '\n')
+
+    def test_battery_is_not_an_ac_supply(self):
+        self.assertEqual(self.monitor.supplies, [os.path.join(self.directory.name, 'AC', 'online')])
+        self.assertTrue(self.monitor.on_ac)
+
+    def test_dropped_events_re_read_the_state(self):
+        self.write('AC', 'online', '0')
+        self.assertTrue(self.monitor.read(FailingSocket(OSError(errno.ENOBUFS, "No buffer space available"))))
+        self.assertEqual(self.controller.selector.selected, 'battery')
+        self.assertIsNotNone(self.monitor.sock)
+
+    def test_socket_error_closes_the_monitor(self):
+        self.assertFalse(self.monitor.read(FailingSocket(*[OSError(errno.EIO, "I/O error")] * 20)))
+        self.assertIsNone(self.monitor.sock)
+        self.assertEqual(self.events.get_map(), {})
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,81 @@
+#!/usr/bin/env python3
+"""
+End-to-end check of the stability tuner: --simulate --tune with a stand-in
+stress command, then the controller running on the curve it wrote.
+
+The simulated GPU logs an Xid when its offset exceeds a hidden limit of
+330 - 0.15 * (clock - 1000) MHz while loaded; the stress command only has to
+run longer than one health-check poll for the tuner to see it.
+
+Run: python3 tests/test_stability_tuner.py
+"""
+
+import contextlib
+import io
+import os
+import sys
+import tempfile
+import unittest
+
+from support import control, simulated_controller
+
+FREQUENCIES = [1400, 1740]
+MARGIN = 30
+STEP = 15  # offset_change_threshold, the bisection resolution
+
+
+def hidden_limit(clock):
+    return 330 - 0.15 * (clock - 1000)
+
+
+class StabilityTunerTest(unittest.TestCase):
+    def setUp(self):
+        self.directory = tempfile.TemporaryDirectory()
+        self.saved_config = dict(control.CONFIG)
+        self.saved_tempdir = tempfile.tempdir
+        tempfile.tempdir = self.directory.name  # --simulate keeps its curve in the temp directory
+        control.CONFIG.update(tune_stress_command='sleep 0.3', tune_frequencies=FREQUENCIES,
+                              tune_margin=MARGIN, offset_change_threshold=STEP, show_info=False)
+
+    def tearDown(self):
+        control.CONFIG.clear()
+        control.CONFIG.update(self.saved_config)
+        tempfile.tempdir = self.saved_tempdir
+        self.directory.cleanup()
+
+    def tune(self):
+        argv = sys.argv
+        sys.argv = ['gpu_offset_control_v2', '--simulate', '--tune']
+        try:
+            with contextlib.redirect_stdout(io.StringIO()):
+                control.main()
+        finally:
+            sys.argv = argv
+        return os.path.join(self.directory.name, 'gpu0.simulated.curve')
+
+    def test_tune_writes_curve_and_controller_stays_within_it(self):
+        curve, stable = control.load_offset_curve(self.tune())
+        self.assertEqual([freq for freq, _ in stable], FREQUENCIES)
+        for (freq, offset), (_, max_stable) in zip(curve, stable):
+            self.assertLessEqual(max_stable, hidden_limit(freq))
+            self.assertGreater(max_stable, hidden_limit(freq) - STEP)
+            self.assertEqual(offset, (max_stable - MARGIN) // STEP * STEP)
+
+        # A large power offset on top of the curve must not lift the total past max_stable
+        time = [30.0]  # Full-load phase of the simulated load pattern: P0
+        controller = simulated_controller({'freq_offset_curve': curve, 'freq_offset_stable_curve': stable,
+                                           'power_offset_max': 120, 'plimit_max': 400}, lambda: time[0])
+        gpu = controller.handle
+        exceeded = 0
+        for _ in range(30):
+            controller.tick()
+            if controller.stats.pstate == 0:
+                limit = control.curve_offset(controller.stats.frequency, stable)
+                self.assertLessEqual(gpu.offsets[0], limit)
+                exceeded += controller.offsets.total_raw > limit
+            time[0] += 1.0
+        self.assertGreater(exceeded, 0, "the unclamped offset never reached max_stable; nothing was tested")
+
+
+if __name__ == '__main__':
+    unittest.main()
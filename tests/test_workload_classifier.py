@@ -0,0 +1,73 @@
+#!/usr/bin/env python3
+"""
+Checks the workload classifier of gpu_offset_control_v2 on the simulated
+load pattern: idle, full load, then partial load with the decoder busy.
+
+Run: python3 tests/test_workload_classifier.py
+"""
+
+import contextlib
+import io
+import unittest
+from unittest import mock
+
+from support import control, simulated_controller
+
+
+class WorkloadClassifierTest(unittest.TestCase):
+    def setUp(self):
+        # One virtual clock for the simulator and the controller's time.monotonic()
+        self.time = [0.0]
+        self.controller = simulated_controller({'workload_classifier_enabled': True,
+                                                'profiles': {'quiet': {'max_clock': 1500}}},
+                                               lambda: self.time[0])
+        self.classifier = control.WorkloadClassifier(self.controller.params, 0, self.controller.selector)
+        self.controller.workload = self.classifier
+
+    def run_until(self, end):
+        """Tick once a second up to end; returns (second, label) at every label switch."""
+        switches = []
+        with mock.patch.object(control.time, 'monotonic', lambda: self.time[0]), \
+                contextlib.redirect_stdout(io.StringIO()):
+            while self.time[0] < end:
+                label = self.classifier.label
+                self.controller.tick()
+                if self.classifier.label != label:
+                    switches.append((int(self.time[0]), self.classifier.label))
+                self.time[0] += 1.0
+        return switches
+
+    def test_labels_follow_the_load_pattern(self):
+        switches = self.run_until(80)
+        self.assertEqual([label for _, label in switches], ['idle', 'compute', 'video'])
+        self.assertEqual(self.controller.selector.selected, 'quiet')
+        self.assertEqual(self.controller.params.max_clock, 1500)
+        self.run_until(100)
+        self.assertEqual(self.classifier.label, 'idle')
+        self.assertEqual(self.controller.selector.selected, 'default')
+
+    def test_new_label_is_held_before_switching(self):
+        hold = self.controller.params.workload_hold
+        switches = dict((label, second) for second, label in self.run_until(40))
+        # The first label is adopted once the window is full, later ones after workload_hold
+        self.assertEqual(switches['idle'], self.controller.params.workload_window - 1)
+        self.assertGreaterEqual(switches['compute'], 20 + hold)
+
+    def test_unsupported_query_is_dropped(self):
+        calls = []
+
+        def unsupported(handle):
+            calls.append(handle)
+            raise control.NVMLError("not supported")
+        control.nvmlDeviceGetUtilizationRates = unsupported
+        self.run_until(5)
+        self.assertEqual(len(calls), 1)
+        self.assertFalse(self.classifier.supported[0])
+
+    def test_slots(self):
+        with self.assertRaises(AttributeError):
+            self.classifier.centroid = None
+
+
+if __name__ == '__main__':
+    unittest.main()